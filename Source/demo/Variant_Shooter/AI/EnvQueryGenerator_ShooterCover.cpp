@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/AI/EnvQueryGenerator_ShooterCover.h"
+#include "EnvironmentQuery/Contexts/EnvQueryContext_Querier.h"
+#include "EnvironmentQuery/Items/EnvQueryItemType_Point.h"
+#include "ShooterCoverIndex.h"
+#include "EngineUtils.h"
+
+UEnvQueryGenerator_ShooterCover::UEnvQueryGenerator_ShooterCover(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	ItemType = UEnvQueryItemType_Point::StaticClass();
+	SearchCenter = UEnvQueryContext_Querier::StaticClass();
+	SearchRadius.DefaultValue = 1500.0f;
+}
+
+void UEnvQueryGenerator_ShooterCover::GenerateItems(FEnvQueryInstance& QueryInstance) const
+{
+	UObject* QueryOwner = QueryInstance.Owner.Get();
+
+	if (!QueryOwner)
+	{
+		return;
+	}
+
+	SearchRadius.BindData(QueryOwner, QueryInstance.QueryID);
+	const float Radius = SearchRadius.GetValue();
+
+	TArray<FVector> CenterLocations;
+	QueryInstance.PrepareContext(SearchCenter, CenterLocations);
+
+	TArray<int32> PointIndices;
+
+	for (const FVector& Center : CenterLocations)
+	{
+		for (TActorIterator<AShooterCoverIndex> It(QueryInstance.World); It; ++It)
+		{
+			PointIndices.Reset();
+			It->GetCoverPointsInRadius(Center, Radius, PointIndices);
+
+			// the points were baked on the navmesh, so pass their poly along
+			for (const int32 PointIndex : PointIndices)
+			{
+				const FShooterCoverPoint& Point = It->GetCoverPoint(PointIndex);
+				QueryInstance.AddItemData<UEnvQueryItemType_Point>(FNavLocation(Point.GetLocation(), Point.NavPoly));
+			}
+		}
+	}
+}
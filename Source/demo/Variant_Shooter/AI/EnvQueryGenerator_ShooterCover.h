@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EnvironmentQuery/EnvQueryGenerator.h"
+#include "DataProviders/AIDataProvider.h"
+#include "EnvQueryGenerator_ShooterCover.generated.h"
+
+/**
+ *  EnvQuery Generator that returns the baked cover points around a context
+ *  Reads the cover point indexes placed in the level instead of sampling the navmesh
+ */
+UCLASS(meta = (DisplayName = "Shooter Cover Points"))
+class DEMO_API UEnvQueryGenerator_ShooterCover : public UEnvQueryGenerator
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Context to search around */
+	UPROPERTY(EditDefaultsOnly, Category="Generator")
+	TSubclassOf<UEnvQueryContext> SearchCenter;
+
+	/** Max distance between the context and the cover points */
+	UPROPERTY(EditDefaultsOnly, Category="Generator")
+	FAIDataProviderFloatValue SearchRadius;
+
+public:
+
+	/** Constructor */
+	UEnvQueryGenerator_ShooterCover(const FObjectInitializer& ObjectInitializer);
+
+	/** Adds the cover points around the search center to the query */
+	virtual void GenerateItems(FEnvQueryInstance& QueryInstance) const override;
+};
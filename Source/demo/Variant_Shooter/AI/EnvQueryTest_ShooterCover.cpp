@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/AI/EnvQueryTest_ShooterCover.h"
+#include "EnvironmentQuery/Items/EnvQueryItemType_VectorBase.h"
+#include "EnvQueryContext_Target.h"
+#include "ShooterCoverIndex.h"
+#include "EngineUtils.h"
+
+UEnvQueryTest_ShooterCover::UEnvQueryTest_ShooterCover(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	Cost = EEnvTestCost::Low;
+	ValidItemType = UEnvQueryItemType_VectorBase::StaticClass();
+	SetWorkOnFloatValues(false);
+
+	Threat = UEnvQueryContext_Target::StaticClass();
+}
+
+void UEnvQueryTest_ShooterCover::RunTest(FEnvQueryInstance& QueryInstance) const
+{
+	UObject* QueryOwner = QueryInstance.Owner.Get();
+
+	if (!QueryOwner)
+	{
+		return;
+	}
+
+	BoolValue.BindData(QueryOwner, QueryInstance.QueryID);
+	const bool bWantsCover = BoolValue.GetValue();
+
+	TArray<FVector> ThreatLocations;
+
+	if (!QueryInstance.PrepareContext(Threat, ThreatLocations))
+	{
+		return;
+	}
+
+	// gather the cover indexes once for all items
+	TArray<const AShooterCoverIndex*, TInlineAllocator<4>> CoverIndexes;
+
+	for (TActorIterator<AShooterCoverIndex> It(QueryInstance.World); It; ++It)
+	{
+		CoverIndexes.Add(*It);
+	}
+
+	for (FEnvQueryInstance::ItemIterator It(this, QueryInstance); It; ++It)
+	{
+		const FVector ItemLocation = GetItemLocation(QueryInstance, It.GetIndex());
+
+		// find the baked point for this item
+		const FShooterCoverPoint* Point = nullptr;
+
+		for (const AShooterCoverIndex* CoverIndex : CoverIndexes)
+		{
+			Point = CoverIndex->FindCoverPointAt(ItemLocation);
+
+			if (Point)
+			{
+				break;
+			}
+		}
+
+		for (const FVector& ThreatLocation : ThreatLocations)
+		{
+			const bool bCovered = Point && Point->IsCoveredFrom(ThreatLocation) && (!bRequirePeek || Point->CanPeekAt(ThreatLocation));
+
+			It.SetScore(TestPurpose, FilterType, bCovered, bWantsCover);
+		}
+	}
+}
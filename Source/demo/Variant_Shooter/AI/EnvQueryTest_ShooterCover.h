@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EnvironmentQuery/EnvQueryTest.h"
+#include "EnvQueryTest_ShooterCover.generated.h"
+
+/**
+ *  EnvQuery Test that checks if baked cover points are covered from a context, usually the NPC's target
+ *  Reads the baked direction bits instead of tracing. Items that aren't baked cover points are never covered
+ */
+UCLASS(meta = (DisplayName = "Shooter Cover"))
+class DEMO_API UEnvQueryTest_ShooterCover : public UEnvQueryTest
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Context to take cover from */
+	UPROPERTY(EditDefaultsOnly, Category="Cover")
+	TSubclassOf<UEnvQueryContext> Threat;
+
+	/** If true, points only count as cover if a standing NPC can also see out towards the threat */
+	UPROPERTY(EditDefaultsOnly, Category="Cover")
+	bool bRequirePeek = true;
+
+public:
+
+	/** Constructor */
+	UEnvQueryTest_ShooterCover(const FObjectInitializer& ObjectInitializer);
+
+	/** Scores the items against the threat */
+	virtual void RunTest(FEnvQueryInstance& QueryInstance) const override;
+};
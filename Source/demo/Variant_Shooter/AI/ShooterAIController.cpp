@@ -3,18 +3,29 @@
 
 #include "Variant_Shooter/AI/ShooterAIController.h"
 #include "ShooterNPC.h"
+#include "ShooterAILODSubsystem.h"
+#include "ShooterTeamSettings.h"
+#include "ShooterSquadSubsystem.h"
+#include "ShooterNPCPoolSubsystem.h"
 #include "Components/StateTreeAIComponent.h"
 #include "Perception/AIPerceptionComponent.h"
+#include "Perception/AISenseConfig_Sight.h"
+#include "Perception/AISense_Hearing.h"
+#include "ShooterAISense_Hearing.h"
 #include "Navigation/PathFollowingComponent.h"
+#include "Navigation/CrowdFollowingComponent.h"
+#include "GameFramework/CharacterMovementComponent.h"
 #include "AI/Navigation/PathFollowingAgentInterface.h"
 
-AShooterAIController::AShooterAIController()
+AShooterAIController::AShooterAIController(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UCrowdFollowingComponent>(TEXT("PathFollowingComponent")))
 {
 	// create the StateTree component
 	StateTreeAI = CreateDefaultSubobject<UStateTreeAIComponent>(TEXT("StateTreeAI"));
 
 	// create the AI perception component. It will be configured in BP
 	AIPerception = CreateDefaultSubobject<UAIPerceptionComponent>(TEXT("AIPerception"));
+	SetPerceptionComponent(*AIPerception);
 
 	// subscribe to the AI perception delegates
 	AIPerception->OnTargetPerceptionUpdated.AddDynamic(this, &AShooterAIController::OnPerceptionUpdated);
@@ -28,11 +39,43 @@ void AShooterAIController::OnPossess(APawn* InPawn)
 	// ensure we're possessing an NPC
 	if (AShooterNPC* NPC = Cast<AShooterNPC>(InPawn))
 	{
-		// add the team tag to the pawn
-		NPC->Tags.Add(TeamTag);
+		// add the team tag to the pawn. Pooled pawns may already have it
+		NPC->Tags.AddUnique(TeamTag);
+
+		// make sure the team attitude table is loaded before perception asks about it
+		GetDefault<UShooterTeamSettings>();
+
+		// take on the pawn's team so perception can tell friend from foe
+		SetGenericTeamId(FGenericTeamId(NPC->GetTeamByte()));
+
+		ApplySenseAffiliation();
+
+		// crowd following behaves like regular path following unless we opt in
+		if (UCrowdFollowingComponent* CrowdFollowing = Cast<UCrowdFollowingComponent>(GetPathFollowingComponent()))
+		{
+			CrowdFollowing->SetCrowdSimulationState(bUseCrowdAvoidance ? ECrowdSimulationState::Enabled : ECrowdSimulationState::Disabled);
+		}
+
+		// the crowd already steers us around other agents, so don't pay for avoidance twice
+		if (bUseCrowdAvoidance)
+		{
+			NPC->GetCharacterMovement()->SetAvoidanceEnabled(false);
+		}
 
 		// subscribe to the pawn's OnDeath delegate
 		NPC->OnPawnDeath.AddDynamic(this, &AShooterAIController::OnPawnDeath);
+
+		// let the AI LOD manager throttle us while no player is around
+		if (UShooterAILODSubsystem* AILOD = GetWorld()->GetSubsystem<UShooterAILODSubsystem>())
+		{
+			AILOD->Auth_RegisterController(this);
+		}
+
+		// share what we sense with the rest of the squad
+		if (UShooterSquadSubsystem* Squads = GetWorld()->GetSubsystem<UShooterSquadSubsystem>())
+		{
+			Squads->Auth_AddMember(this);
+		}
 	}
 }
 
@@ -44,9 +87,27 @@ void AShooterAIController::OnPawnDeath()
 	// stop StateTree logic
 	StateTreeAI->StopLogic(FString(""));
 
+	// leave the squad so our line of sight checks get reassigned
+	if (UShooterSquadSubsystem* Squads = GetWorld()->GetSubsystem<UShooterSquadSubsystem>())
+	{
+		Squads->Auth_RemoveMember(this);
+	}
+
+	const AShooterNPC* NPC = Cast<AShooterNPC>(GetPawn());
+
 	// unpossess the pawn
 	UnPossess();
 
+	// pooled NPCs hand their controller back for the next spawn
+	if (NPC && NPC->IsPooled())
+	{
+		if (UShooterNPCPoolSubsystem* Pool = GetWorld()->GetSubsystem<UShooterNPCPoolSubsystem>())
+		{
+			Pool->Auth_ReleaseController(this);
+			return;
+		}
+	}
+
 	// destroy this controller
 	Destroy();
 }
@@ -61,14 +122,122 @@ void AShooterAIController::ClearCurrentTarget()
 	TargetEnemy = nullptr;
 }
 
+bool AShooterAIController::IsHostile(const AActor* Actor, FName FallbackTag) const
+{
+	if (!Actor)
+	{
+		return false;
+	}
+
+	// team agents are judged by attitude
+	if (Cast<const IGenericTeamAgentInterface>(Actor))
+	{
+		return FGenericTeamId::GetAttitude(this, Actor) == ETeamAttitude::Hostile;
+	}
+
+	return Actor->ActorHasTag(FallbackTag);
+}
+
+void AShooterAIController::Auth_EnterPool()
+{
+	StateTreeAI->StopLogic(FString(""));
+
+	ClearCurrentTarget();
+
+	// forget everything so the next pawn doesn't inherit old stimuli
+	AIPerception->ForgetAll();
+	AIPerception->SetActive(false);
+
+	ClearPerceptionEvents();
+}
+
+void AShooterAIController::Auth_LeavePool()
+{
+	AIPerception->SetActive(true);
+
+	// start the StateTree over from its root state with fresh instance data
+	StateTreeAI->RestartLogic();
+}
+
+void AShooterAIController::DrainPerceptionEvents(TFunctionRef<void(const FShooterPerceptionEvent&)> Visitor)
+{
+	for (const FShooterPerceptionEvent& Event : PerceptionQueue)
+	{
+		Visitor(Event);
+	}
+
+	ClearPerceptionEvents();
+}
+
+void AShooterAIController::ClearPerceptionEvents()
+{
+	PerceptionQueue.Reset();
+}
+
+void AShooterAIController::ApplySenseAffiliation()
+{
+	if (!bSenseEnemiesOnly)
+	{
+		return;
+	}
+
+	// the sight config is set up in BP, so tighten it at runtime
+	if (UAISenseConfig_Sight* SightConfig = Cast<UAISenseConfig_Sight>(AIPerception->GetSenseConfig(UAISense::GetSenseID<UAISense_Sight>())))
+	{
+		SightConfig->DetectionByAffiliation.bDetectEnemies = true;
+		SightConfig->DetectionByAffiliation.bDetectNeutrals = false;
+		SightConfig->DetectionByAffiliation.bDetectFriendlies = false;
+
+		AIPerception->ConfigureSense(*SightConfig);
+	}
+
+	// the team changed, so let the perception system re-evaluate our listener
+	AIPerception->RequestStimuliListenerUpdate();
+}
+
+FShooterPerceptionEvent& AShooterAIController::FindOrQueuePerceptionEvent(AActor* Actor)
+{
+	// merge with the actor's queued event, so the queue only grows with the number of actors perceived
+	if (FShooterPerceptionEvent* Event = PerceptionQueue.FindByPredicate([Actor](const FShooterPerceptionEvent& Other) { return Other.Actor == Actor; }))
+	{
+		return *Event;
+	}
+
+	FShooterPerceptionEvent& Event = PerceptionQueue.AddDefaulted_GetRef();
+	Event.Actor = Actor;
+
+	return Event;
+}
+
 void AShooterAIController::OnPerceptionUpdated(AActor* Actor, FAIStimulus Stimulus)
 {
-	// pass the data to the StateTree delegate hook
-	OnShooterPerceptionUpdated.ExecuteIfBound(Actor, Stimulus);
+	// hearing a noise means a fight nearby, so run at full rate for a while
+	const bool bHeard = Stimulus.Type == UAISense::GetSenseID<UAISense_Hearing>() || Stimulus.Type == UAISense::GetSenseID<UShooterAISense_Hearing>();
+
+	if (bHeard && Stimulus.WasSuccessfullySensed())
+	{
+		if (UShooterAILODSubsystem* AILOD = GetWorld()->GetSubsystem<UShooterAILODSubsystem>())
+		{
+			AILOD->Auth_NotifyCombat(this);
+		}
+	}
+
+	// queue the stimulus for the StateTree to process on its next tick, keeping the strongest one per actor
+	FShooterPerceptionEvent& Event = FindOrQueuePerceptionEvent(Actor);
+
+	if (!Event.bSensed || Stimulus.Strength > Event.Strength)
+	{
+		Event.Location = Stimulus.StimulusLocation;
+		Event.Strength = Stimulus.Strength;
+		Event.bSensed = true;
+	}
 }
 
 void AShooterAIController::OnPerceptionForgotten(AActor* Actor)
 {
-	// pass the data to the StateTree delegate hook
-	OnShooterPerceptionForgotten.ExecuteIfBound(Actor);
+	// queue the forget for the StateTree to process on its next tick. It supersedes anything sensed before it
+	FShooterPerceptionEvent& Event = FindOrQueuePerceptionEvent(Actor);
+	Event.bForgotten = true;
+	Event.bSensed = false;
+	Event.Strength = 0.0f;
 }
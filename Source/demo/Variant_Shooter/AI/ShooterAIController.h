@@ -10,8 +10,24 @@ class UStateTreeAIComponent;
 class UAIPerceptionComponent;
 struct FAIStimulus;
 
-DECLARE_DELEGATE_TwoParams(FShooterPerceptionUpdatedDelegate, AActor*, const FAIStimulus&);
-DECLARE_DELEGATE_OneParam(FShooterPerceptionForgottenDelegate, AActor*);
+/** Everything perceived about an actor since the StateTree last processed perception, merged into one event */
+struct FShooterPerceptionEvent
+{
+	/** Perceived actor */
+	TWeakObjectPtr<AActor> Actor;
+
+	/** Location of the strongest stimulus */
+	FVector Location = FVector::ZeroVector;
+
+	/** Strength of the strongest stimulus */
+	float Strength = 0.0f;
+
+	/** If true, the actor was sensed after it was last forgotten */
+	bool bSensed = false;
+
+	/** If true, the actor was forgotten */
+	bool bForgotten = false;
+};
 
 /**
  *  Simple AI Controller for a first person shooter enemy
@@ -35,29 +51,34 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Shooter")
 	FName TeamTag = FName("Enemy");
 
-	/** Enemy currently being targeted */
-	TObjectPtr<AActor> TargetEnemy;
+	/** If true, sight only registers hostile actors so friendlies and neutrals are filtered out before any stimulus is processed */
+	UPROPERTY(EditAnywhere, Category="Shooter")
+	bool bSenseEnemiesOnly = true;
 
-public:
+	/** If true, the NPC steers around other NPCs with the Detour crowd instead of the character movement's own avoidance */
+	UPROPERTY(EditAnywhere, Category="Shooter")
+	bool bUseCrowdAvoidance = false;
 
-	/** Called when an AI perception has been updated. StateTree task delegate hook */
-	FShooterPerceptionUpdatedDelegate OnShooterPerceptionUpdated;
+	/** Squad this NPC shares perception with, among NPCs of the same team. 0 keeps the NPC out of any squad */
+	UPROPERTY(EditAnywhere, Category="Shooter")
+	uint8 SquadId = 0;
 
-	/** Called when an AI perception has been forgotten. StateTree task delegate hook */
-	FShooterPerceptionForgottenDelegate OnShooterPerceptionForgotten;
+	/** Enemy currently being targeted */
+	TObjectPtr<AActor> TargetEnemy;
+
+	/** Perception events waiting for the StateTree, one per actor in the order they were first perceived */
+	TArray<FShooterPerceptionEvent> PerceptionQueue;
 
 public:
 
 	/** Constructor */
-	AShooterAIController();
+	AShooterAIController(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
 
 protected:
 
 	/** Pawn initialization */
 	virtual void OnPossess(APawn* InPawn) override;
 
-protected:
-
 	/** Called when the possessed pawn dies */
 	UFUNCTION()
 	void OnPawnDeath();
@@ -73,8 +94,38 @@ public:
 	/** Returns the targeted enemy */
 	AActor* GetCurrentTarget() const { return TargetEnemy; };
 
+	/** Returns the StateTree component */
+	UStateTreeAIComponent* GetStateTreeAI() const { return StateTreeAI; };
+
+	/** Returns the AI perception component */
+	UAIPerceptionComponent* GetShooterPerception() const { return AIPerception; };
+
+	/** Returns the squad ID */
+	uint8 GetSquadId() const { return SquadId; };
+
+	/** Returns true if the given actor is hostile to this controller's team. Falls back to the tag for actors that aren't team agents */
+	bool IsHostile(const AActor* Actor, FName FallbackTag) const;
+
+	/** Stops thinking and perceiving while parked in the NPC pool */
+	void Auth_EnterPool();
+
+	/** Starts over with a fresh StateTree and no memories after possessing a pawn from the pool */
+	void Auth_LeavePool();
+
+	/** Passes the queued perception events to the visitor, in the order the actors were first perceived, and empties the queue */
+	void DrainPerceptionEvents(TFunctionRef<void(const FShooterPerceptionEvent&)> Visitor);
+
+	/** Drops the queued perception events */
+	void ClearPerceptionEvents();
+
 protected:
 
+	/** Restricts the sight sense to hostile actors */
+	void ApplySenseAffiliation();
+
+	/** Returns the queued event for an actor, adding one if there's none */
+	FShooterPerceptionEvent& FindOrQueuePerceptionEvent(AActor* Actor);
+
 	/** Called when the AI perception component updates a perception on a given actor */
 	UFUNCTION()
 	void OnPerceptionUpdated(AActor* Actor, FAIStimulus Stimulus);
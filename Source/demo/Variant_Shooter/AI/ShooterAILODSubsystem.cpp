@@ -0,0 +1,379 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/AI/ShooterAILODSubsystem.h"
+#include "ShooterAIController.h"
+#include "ShooterNPC.h"
+#include "Components/StateTreeAIComponent.h"
+#include "Perception/AIPerceptionComponent.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/World.h"
+#include "HAL/PlatformTime.h"
+
+void UShooterAILODSubsystem::Auth_RegisterController(AShooterAIController* Controller)
+{
+	if (!bEnabled || !Controller)
+	{
+		return;
+	}
+
+	// pooled controllers may come back before their old entry was dropped
+	FAILODEntry* ExistingEntry = FindEntry(Controller);
+
+	if (!ExistingEntry)
+	{
+		EntryIndices.Add(Controller, Entries.Num());
+	}
+
+	FAILODEntry& Entry = ExistingEntry ? *ExistingEntry : Entries.AddDefaulted_GetRef();
+	Entry.Controller = Controller;
+	Entry.Key = Controller;
+	Entry.LastBudgetedTickTime = GetWorld()->GetTimeSeconds();
+
+	// we own the StateTree's tick rate, so don't let its scheduled tick turn the tick back on behind our back
+	Controller->GetStateTreeAI()->SetScheduledTickAllowed(false);
+
+	// start at full rate, the next evaluation will sort it out
+	ApplyTier(Entry, EShooterAILODTier::Combat);
+}
+
+void UShooterAILODSubsystem::Auth_NotifyCombat(AShooterAIController* Controller)
+{
+	if (FAILODEntry* Entry = FindEntry(Controller))
+	{
+		Entry->LastCombatTime = GetWorld()->GetTimeSeconds();
+
+		if (Entry->Tier != EShooterAILODTier::Combat)
+		{
+			ApplyTier(*Entry, EShooterAILODTier::Combat);
+		}
+	}
+}
+
+void UShooterAILODSubsystem::Auth_ReportNoise(const FVector& Location, float Range)
+{
+	// awake NPCs hear noises through their own perception, so only the hibernating ones need checking
+	if (Range <= 0.0f || HibernatingCells.Num() == 0)
+	{
+		return;
+	}
+
+	const FIntPoint MinCell = GetWakeCell(Location - FVector(Range));
+	const FIntPoint MaxCell = GetWakeCell(Location + FVector(Range));
+
+	// gather the occupied cells in range, walking whichever is smaller: the covered cells or the occupied ones
+	TArray<const TArray<TObjectKey<AShooterAIController>, TInlineAllocator<4>>*, TInlineAllocator<16>> NearbyCells;
+
+	const int64 NumCoveredCells = static_cast<int64>(MaxCell.X - MinCell.X + 1) * (MaxCell.Y - MinCell.Y + 1);
+
+	if (NumCoveredCells <= HibernatingCells.Num())
+	{
+		for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+		{
+			for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+			{
+				if (const TArray<TObjectKey<AShooterAIController>, TInlineAllocator<4>>* Cell = HibernatingCells.Find(FIntPoint(X, Y)))
+				{
+					NearbyCells.Add(Cell);
+				}
+			}
+		}
+
+	} else {
+
+		for (const TPair<FIntPoint, TArray<TObjectKey<AShooterAIController>, TInlineAllocator<4>>>& Pair : HibernatingCells)
+		{
+			if (Pair.Key.X >= MinCell.X && Pair.Key.X <= MaxCell.X && Pair.Key.Y >= MinCell.Y && Pair.Key.Y <= MaxCell.Y)
+			{
+				NearbyCells.Add(&Pair.Value);
+			}
+		}
+
+	}
+
+	// collect first, since waking an NPC takes it out of its cell
+	TArray<int32, TInlineAllocator<16>> WokenEntries;
+	const float RangeSquared = FMath::Square(Range);
+
+	for (const TArray<TObjectKey<AShooterAIController>, TInlineAllocator<4>>* Cell : NearbyCells)
+	{
+		for (const TObjectKey<AShooterAIController>& Key : *Cell)
+		{
+			const int32* Index = EntryIndices.Find(Key);
+			const AShooterAIController* Controller = Index ? Entries[*Index].Controller.Get() : nullptr;
+			const APawn* Pawn = Controller ? Controller->GetPawn() : nullptr;
+
+			if (Pawn && FVector::DistSquared(Pawn->GetActorLocation(), Location) < RangeSquared)
+			{
+				WokenEntries.Add(*Index);
+			}
+		}
+	}
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	for (int32 Index : WokenEntries)
+	{
+		FAILODEntry& Entry = Entries[Index];
+		Entry.LastWakeTime = Now;
+
+		// wake up with perception on, combat starts if we actually perceive something
+		ApplyTier(Entry, EShooterAILODTier::Far);
+	}
+}
+
+bool UShooterAILODSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterAILODSubsystem::Tick(float DeltaTime)
+{
+	if (Entries.Num() == 0)
+	{
+		return;
+	}
+
+	TimeUntilEvaluation -= DeltaTime;
+
+	if (TimeUntilEvaluation <= 0.0f)
+	{
+		TimeUntilEvaluation = EvaluationInterval;
+		EvaluateTiers();
+	}
+
+	TickBudgetedEntries();
+}
+
+TStatId UShooterAILODSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterAILODSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterAILODSubsystem::EvaluateTiers()
+{
+	// gather the player locations once
+	TArray<FVector, TInlineAllocator<8>> PlayerLocations;
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const APawn* PlayerPawn = It->Get() ? It->Get()->GetPawn() : nullptr)
+		{
+			PlayerLocations.Add(PlayerPawn->GetActorLocation());
+		}
+	}
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	for (int32 i = Entries.Num() - 1; i >= 0; --i)
+	{
+		FAILODEntry& Entry = Entries[i];
+
+		// drop controllers that went away
+		if (!Entry.Controller.IsValid() || !Entry.Controller->GetPawn())
+		{
+			RemoveEntryAt(i);
+			continue;
+		}
+
+		const EShooterAILODTier NewTier = ComputeTier(Entry, PlayerLocations, Now);
+
+		if (NewTier != Entry.Tier)
+		{
+			ApplyTier(Entry, NewTier);
+		}
+	}
+}
+
+EShooterAILODTier UShooterAILODSubsystem::ComputeTier(const FAILODEntry& Entry, const TArray<FVector, TInlineAllocator<8>>& PlayerLocations, double Now) const
+{
+	const AShooterAIController* Controller = Entry.Controller.Get();
+
+	// anything fighting runs at full rate
+	const bool bInCombat = IsValid(Controller->GetCurrentTarget()) || Now - Entry.LastCombatTime < CombatHoldTime;
+
+	if (bInCombat)
+	{
+		return EShooterAILODTier::Combat;
+	}
+
+	// find the nearest player
+	const FVector Location = Controller->GetPawn()->GetActorLocation();
+
+	float NearestDistanceSquared = UE_BIG_NUMBER;
+
+	for (const FVector& PlayerLocation : PlayerLocations)
+	{
+		NearestDistanceSquared = FMath::Min(NearestDistanceSquared, static_cast<float>(FVector::DistSquared(Location, PlayerLocation)));
+	}
+
+	if (NearestDistanceSquared < FMath::Square(NearDistance))
+	{
+		return EShooterAILODTier::Near;
+	}
+
+	// NPCs woken by a noise stay awake for a while, so they can hear what follows
+	const bool bRecentlyWoken = Now - Entry.LastWakeTime < WakeHoldTime;
+
+	return NearestDistanceSquared < FMath::Square(HibernateDistance) || bRecentlyWoken ? EShooterAILODTier::Far : EShooterAILODTier::Hibernating;
+}
+
+void UShooterAILODSubsystem::ApplyTier(FAILODEntry& Entry, EShooterAILODTier NewTier)
+{
+	AShooterAIController* Controller = Entry.Controller.Get();
+	AShooterNPC* NPC = Controller ? Cast<AShooterNPC>(Controller->GetPawn()) : nullptr;
+
+	if (!NPC)
+	{
+		return;
+	}
+
+	const FShooterAILODTierSettings& Settings = GetTierSettings(NewTier);
+
+	// budgeted tiers are ticked by the subsystem instead of the tick manager
+	UStateTreeAIComponent* StateTree = Controller->GetStateTreeAI();
+	StateTree->SetComponentTickEnabled(Settings.bTickEnabled && !Settings.bBudgeted);
+	StateTree->SetComponentTickInterval(Settings.StateTreeTickInterval);
+
+	UCharacterMovementComponent* Movement = NPC->GetCharacterMovement();
+	Movement->SetComponentTickEnabled(Settings.bTickEnabled);
+	Movement->SetComponentTickInterval(Settings.MovementTickInterval);
+
+	// switch between full walking and navmesh walking, now or when the NPC next lands
+	NPC->Auth_SetNavWalkOnGround(Settings.bNavWalking);
+
+	// hibernating NPCs stop where they are
+	if (!Settings.bTickEnabled)
+	{
+		Controller->StopMovement();
+	}
+
+	UAIPerceptionComponent* Perception = Controller->GetShooterPerception();
+
+	if (Settings.bPerceptionEnabled != Perception->IsActive())
+	{
+		Perception->SetActive(Settings.bPerceptionEnabled);
+	}
+
+	// don't let a freshly budgeted NPC catch up on time it spent ticking normally
+	if (Settings.bBudgeted && !GetTierSettings(Entry.Tier).bBudgeted)
+	{
+		Entry.LastBudgetedTickTime = GetWorld()->GetTimeSeconds();
+	}
+
+	// file hibernating NPCs by location so noises can find them. They don't move until they wake up
+	if (Entry.Tier == EShooterAILODTier::Hibernating && NewTier != EShooterAILODTier::Hibernating)
+	{
+		RemoveFromWakeCell(Entry);
+
+	} else if (Entry.Tier != EShooterAILODTier::Hibernating && NewTier == EShooterAILODTier::Hibernating) {
+
+		Entry.WakeCell = GetWakeCell(NPC->GetActorLocation());
+		HibernatingCells.FindOrAdd(Entry.WakeCell).Add(Entry.Key);
+	}
+
+	Entry.Tier = NewTier;
+}
+
+void UShooterAILODSubsystem::TickBudgetedEntries()
+{
+	if (Entries.Num() == 0)
+	{
+		return;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double Budget = BudgetMilliseconds * 0.001;
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	// visit each entry at most once per frame, starting where we left off
+	const int32 NumEntries = Entries.Num();
+
+	for (int32 Visited = 0; Visited < NumEntries; ++Visited)
+	{
+		if (FPlatformTime::Seconds() - StartTime > Budget)
+		{
+			break;
+		}
+
+		NextBudgetedEntry = (NextBudgetedEntry + 1) % NumEntries;
+
+		FAILODEntry& Entry = Entries[NextBudgetedEntry];
+		const FShooterAILODTierSettings& Settings = GetTierSettings(Entry.Tier);
+
+		if (!Settings.bBudgeted || !Entry.Controller.IsValid())
+		{
+			continue;
+		}
+
+		// wait for the tier's interval, an NPC that was skipped over budget just gets a longer step next time
+		const float StepTime = static_cast<float>(Now - Entry.LastBudgetedTickTime);
+
+		if (StepTime < Settings.StateTreeTickInterval)
+		{
+			continue;
+		}
+
+		Entry.LastBudgetedTickTime = Now;
+
+		// scheduled ticking is off for managed StateTrees, so its regular tick stays disabled while we drive it
+		UActorComponent* StateTree = Entry.Controller->GetStateTreeAI();
+		StateTree->TickComponent(StepTime, LEVELTICK_All, &StateTree->PrimaryComponentTick);
+	}
+}
+
+const FShooterAILODTierSettings& UShooterAILODSubsystem::GetTierSettings(EShooterAILODTier Tier) const
+{
+	switch (Tier)
+	{
+	case EShooterAILODTier::Combat:
+		return CombatTier;
+
+	case EShooterAILODTier::Near:
+		return NearTier;
+
+	case EShooterAILODTier::Far:
+		return FarTier;
+
+	default:
+		return HibernatingTier;
+	}
+}
+
+UShooterAILODSubsystem::FAILODEntry* UShooterAILODSubsystem::FindEntry(const AShooterAIController* Controller)
+{
+	const int32* Index = Controller ? EntryIndices.Find(Controller) : nullptr;
+	return Index ? &Entries[*Index] : nullptr;
+}
+
+void UShooterAILODSubsystem::RemoveEntryAt(int32 Index)
+{
+	if (Entries[Index].Tier == EShooterAILODTier::Hibernating)
+	{
+		RemoveFromWakeCell(Entries[Index]);
+	}
+
+	EntryIndices.Remove(Entries[Index].Key);
+	Entries.RemoveAtSwap(Index, EAllowShrinking::No);
+
+	// the last entry was moved into the hole
+	if (Entries.IsValidIndex(Index))
+	{
+		EntryIndices.Add(Entries[Index].Key, Index);
+	}
+}
+
+void UShooterAILODSubsystem::RemoveFromWakeCell(const FAILODEntry& Entry)
+{
+	if (TArray<TObjectKey<AShooterAIController>, TInlineAllocator<4>>* Cell = HibernatingCells.Find(Entry.WakeCell))
+	{
+		Cell->RemoveSwap(Entry.Key, EAllowShrinking::No);
+
+		if (Cell->Num() == 0)
+		{
+			HibernatingCells.Remove(Entry.WakeCell);
+		}
+	}
+}
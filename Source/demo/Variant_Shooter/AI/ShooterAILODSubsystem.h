@@ -0,0 +1,226 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "ShooterAILODSubsystem.generated.h"
+
+class AShooterAIController;
+
+/**
+ *  AI level of detail tiers, from most to least expensive
+ */
+UENUM()
+enum class EShooterAILODTier : uint8
+{
+	/** Has a target or was recently in combat */
+	Combat,
+
+	/** Close to a player */
+	Near,
+
+	/** Far from every player. Ticked by the subsystem within the frame's AI budget */
+	Far,
+
+	/** Idle and very far from every player. Doesn't tick until woken by proximity or noise */
+	Hibernating
+};
+
+/**
+ *  Update rates applied to NPCs in an AI LOD tier
+ */
+USTRUCT()
+struct FShooterAILODTierSettings
+{
+	GENERATED_BODY()
+
+	/** Tick interval for the StateTree. Zero ticks every frame */
+	UPROPERTY(Config)
+	float StateTreeTickInterval = 0.0f;
+
+	/** Tick interval for the NPC's character movement. Zero ticks every frame */
+	UPROPERTY(Config)
+	float MovementTickInterval = 0.0f;
+
+	/** If false, the NPC's perception is deactivated */
+	UPROPERTY(Config)
+	bool bPerceptionEnabled = true;
+
+	/** If true, the StateTree is ticked round-robin by the subsystem within the frame's AI budget */
+	UPROPERTY(Config)
+	bool bBudgeted = false;
+
+	/** If false, the StateTree and movement don't tick at all */
+	UPROPERTY(Config)
+	bool bTickEnabled = true;
+
+	/** If true, the NPC walks along the navmesh without floor checks or collision sweeps */
+	UPROPERTY(Config)
+	bool bNavWalking = false;
+
+	FShooterAILODTierSettings() = default;
+
+	FShooterAILODTierSettings(float InStateTreeTickInterval, float InMovementTickInterval, bool bInPerceptionEnabled, bool bInBudgeted, bool bInTickEnabled, bool bInNavWalking = false)
+		: StateTreeTickInterval(InStateTreeTickInterval)
+		, MovementTickInterval(InMovementTickInterval)
+		, bPerceptionEnabled(bInPerceptionEnabled)
+		, bBudgeted(bInBudgeted)
+		, bTickEnabled(bInTickEnabled)
+		, bNavWalking(bInNavWalking)
+	{}
+};
+
+/**
+ *  Server-side AI level of detail manager
+ *  Sorts NPCs into tiers by distance to the nearest player and by combat state, and applies each tier's update rates
+ *  Lower tiers share a per-frame millisecond budget and are ticked round-robin
+ *  Idle NPCs far from every player hibernate until a player comes close or a noise is made near them
+ *  Awake NPCs are only held in the combat tier by what they actually perceive, so distant firefights don't wake the whole map
+ *  Distant tiers also swap full walking physics for navmesh walking, which skips floor sweeps and collision
+ */
+UCLASS(config=Game)
+class DEMO_API UShooterAILODSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Tracks a registered NPC controller */
+	struct FAILODEntry
+	{
+		/** Controller being managed */
+		TWeakObjectPtr<AShooterAIController> Controller;
+
+		/** Key the entry is indexed under, valid even after the controller is gone */
+		TObjectKey<AShooterAIController> Key;
+
+		/** Tier currently applied */
+		EShooterAILODTier Tier = EShooterAILODTier::Near;
+
+		/** Last time the NPC was in combat */
+		double LastCombatTime = -UE_BIG_NUMBER;
+
+		/** Last time the NPC was woken up from hibernation by a noise */
+		double LastWakeTime = -UE_BIG_NUMBER;
+
+		/** Last time the subsystem ticked the StateTree, for budgeted tiers */
+		double LastBudgetedTickTime = 0.0;
+
+		/** Wake cell the NPC is filed under while hibernating */
+		FIntPoint WakeCell = FIntPoint::ZeroValue;
+	};
+
+	/** If false, every NPC runs at full rate */
+	UPROPERTY(Config)
+	bool bEnabled = true;
+
+	/** Distance to the nearest player under which NPCs are in the near tier */
+	UPROPERTY(Config)
+	float NearDistance = 4000.0f;
+
+	/** Distance to the nearest player above which idle NPCs hibernate */
+	UPROPERTY(Config)
+	float HibernateDistance = 12000.0f;
+
+	/** Time NPCs stay in the combat tier after losing their target or hearing a noise */
+	UPROPERTY(Config)
+	float CombatHoldTime = 5.0f;
+
+	/** Time NPCs woken by a noise stay awake before they may hibernate again */
+	UPROPERTY(Config)
+	float WakeHoldTime = 5.0f;
+
+	/** Size of the cells hibernating NPCs are filed under for noise wake ups */
+	UPROPERTY(Config)
+	float WakeCellSize = 2000.0f;
+
+	/** Time between tier evaluations */
+	UPROPERTY(Config)
+	float EvaluationInterval = 0.5f;
+
+	/** Milliseconds per frame the subsystem may spend ticking budgeted NPCs */
+	UPROPERTY(Config)
+	float BudgetMilliseconds = 1.0f;
+
+	/** Update rates for the combat tier */
+	UPROPERTY(Config)
+	FShooterAILODTierSettings CombatTier;
+
+	/** Update rates for the near tier */
+	UPROPERTY(Config)
+	FShooterAILODTierSettings NearTier = FShooterAILODTierSettings(0.1f, 0.0f, true, false, true);
+
+	/** Update rates for the far tier */
+	UPROPERTY(Config)
+	FShooterAILODTierSettings FarTier = FShooterAILODTierSettings(0.5f, 0.2f, true, true, true, true);
+
+	/** Update rates for hibernating NPCs */
+	UPROPERTY(Config)
+	FShooterAILODTierSettings HibernatingTier = FShooterAILODTierSettings(0.0f, 0.0f, false, false, false, true);
+
+	/** Managed NPCs */
+	TArray<FAILODEntry> Entries;
+
+	/** Index into Entries of each managed controller */
+	TMap<TObjectKey<AShooterAIController>, int32> EntryIndices;
+
+	/** Hibernating NPCs by wake cell */
+	TMap<FIntPoint, TArray<TObjectKey<AShooterAIController>, TInlineAllocator<4>>> HibernatingCells;
+
+	/** Round-robin position for budgeted ticks */
+	int32 NextBudgetedEntry = 0;
+
+	/** Time left until the next tier evaluation */
+	float TimeUntilEvaluation = 0.0f;
+
+public:
+
+	/** Starts managing an NPC controller */
+	void Auth_RegisterController(AShooterAIController* Controller);
+
+	/** Puts an NPC in the combat tier right away, e.g. when it takes damage or hears a noise */
+	void Auth_NotifyCombat(AShooterAIController* Controller);
+
+	/** Wakes hibernating NPCs within range of a noise, so their perception can pick up what follows */
+	void Auth_ReportNoise(const FVector& Location, float Range);
+
+protected:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+
+	/** Re-tiers every NPC */
+	void EvaluateTiers();
+
+	/** Ticks budgeted NPCs round-robin until the frame's budget runs out */
+	void TickBudgetedEntries();
+
+	/** Works out the tier an NPC belongs to */
+	EShooterAILODTier ComputeTier(const FAILODEntry& Entry, const TArray<FVector, TInlineAllocator<8>>& PlayerLocations, double Now) const;
+
+	/** Applies a tier's update rates to an NPC */
+	void ApplyTier(FAILODEntry& Entry, EShooterAILODTier NewTier);
+
+	/** Returns the settings for a tier */
+	const FShooterAILODTierSettings& GetTierSettings(EShooterAILODTier Tier) const;
+
+	/** Returns the entry for a controller, if it's managed */
+	FAILODEntry* FindEntry(const AShooterAIController* Controller);
+
+	/** Stops managing the NPC at the given index */
+	void RemoveEntryAt(int32 Index);
+
+	/** Removes a hibernating NPC from its wake cell */
+	void RemoveFromWakeCell(const FAILODEntry& Entry);
+
+	/** Returns the wake cell containing a location */
+	FIntPoint GetWakeCell(const FVector& Location) const
+	{
+		return FIntPoint(FMath::FloorToInt32(Location.X / WakeCellSize), FMath::FloorToInt32(Location.Y / WakeCellSize));
+	}
+};
@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/AI/ShooterAISenseConfig_Hearing.h"
+#include "ShooterAISense_Hearing.h"
+
+UShooterAISenseConfig_Hearing::UShooterAISenseConfig_Hearing(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	DebugColor = FColor::Yellow;
+
+	Implementation = UShooterAISense_Hearing::StaticClass();
+
+	// hear everyone unless told otherwise
+	DetectionByAffiliation.bDetectEnemies = true;
+	DetectionByAffiliation.bDetectNeutrals = true;
+	DetectionByAffiliation.bDetectFriendlies = true;
+}
+
+TSubclassOf<UAISense> UShooterAISenseConfig_Hearing::GetSenseImplementation() const
+{
+	return Implementation;
+}
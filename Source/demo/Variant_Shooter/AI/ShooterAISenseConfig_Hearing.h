@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Perception/AISenseConfig.h"
+#include "Perception/AIPerceptionTypes.h"
+#include "ShooterAISenseConfig_Hearing.generated.h"
+
+class UShooterAISense_Hearing;
+
+/**
+ *  Perception config for the spatially partitioned shooter hearing sense
+ *  Use it in place of the default hearing config on NPC perception components
+ */
+UCLASS(meta = (DisplayName = "Shooter AI Hearing config"))
+class DEMO_API UShooterAISenseConfig_Hearing : public UAISenseConfig
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Sense implementation used by this config */
+	UPROPERTY(EditDefaultsOnly, Category="Sense", NoClear, config)
+	TSubclassOf<UShooterAISense_Hearing> Implementation;
+
+	/** Range at which noises of loudness 1 are heard */
+	UPROPERTY(EditDefaultsOnly, Category="Sense", meta = (UIMin = 0.0, ClampMin = 0.0, Units = "cm"))
+	float HearingRange = 3000.0f;
+
+	/** Teams whose noises are heard */
+	UPROPERTY(EditDefaultsOnly, Category="Sense", config)
+	FAISenseAffiliationFilter DetectionByAffiliation;
+
+public:
+
+	/** Constructor */
+	UShooterAISenseConfig_Hearing(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	/** Returns the sense class to instantiate for this config */
+	virtual TSubclassOf<UAISense> GetSenseImplementation() const override;
+};
@@ -0,0 +1,229 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/AI/ShooterAISense_Hearing.h"
+#include "ShooterAISenseConfig_Hearing.h"
+#include "Perception/AIPerceptionSystem.h"
+#include "Perception/AIPerceptionComponent.h"
+
+UShooterAISense_Hearing::UShooterAISense_Hearing(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	if (!HasAnyFlags(RF_ClassDefaultObject))
+	{
+		OnNewListenerDelegate.BindUObject(this, &UShooterAISense_Hearing::OnNewListenerImpl);
+		OnListenerUpdateDelegate.BindUObject(this, &UShooterAISense_Hearing::OnListenerUpdateImpl);
+		OnListenerRemovedDelegate.BindUObject(this, &UShooterAISense_Hearing::OnListenerRemovedImpl);
+	}
+}
+
+void UShooterAISense_Hearing::RegisterEvent(const FAINoiseEvent& Event)
+{
+	NoiseEvents.Add(Event);
+
+	RequestImmediateUpdate();
+}
+
+void UShooterAISense_Hearing::ReportNoiseEvent(UObject* WorldContextObject, const FVector& NoiseLocation, float Loudness, AActor* Instigator, float MaxRange, FName Tag)
+{
+	// nothing happens unless some listener uses this sense
+	if (UAIPerceptionSystem* PerceptionSystem = UAIPerceptionSystem::GetCurrent(WorldContextObject))
+	{
+		const FAINoiseEvent Event(Instigator, NoiseLocation, Loudness, MaxRange, Tag);
+		PerceptionSystem->OnEvent<FAINoiseEvent, UShooterAISense_Hearing>(Event);
+	}
+}
+
+float UShooterAISense_Hearing::Update()
+{
+	AIPerception::FListenerMap& ListenersMap = *GetListeners();
+
+	RefreshListenerCells(ListenersMap);
+
+	for (const FAINoiseEvent& Event : NoiseEvents)
+	{
+		// farthest any listener could hear this noise from
+		float Reach = MaxHearingRange * Event.Loudness;
+
+		if (Event.MaxRange > 0.0f)
+		{
+			Reach = FMath::Min(Reach, Event.MaxRange);
+		}
+
+		const FIntPoint MinCell = GetCell(Event.NoiseLocation - FVector(Reach));
+		const FIntPoint MaxCell = GetCell(Event.NoiseLocation + FVector(Reach));
+
+		// gather the occupied cells in reach, walking whichever is smaller: the covered cells or the occupied ones
+		TArray<const TArray<FPerceptionListenerID, TInlineAllocator<4>>*, TInlineAllocator<32>> NearbyCells;
+
+		const int64 NumCoveredCells = static_cast<int64>(MaxCell.X - MinCell.X + 1) * (MaxCell.Y - MinCell.Y + 1);
+
+		if (NumCoveredCells <= Cells.Num())
+		{
+			for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+			{
+				for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+				{
+					if (const TArray<FPerceptionListenerID, TInlineAllocator<4>>* Cell = Cells.Find(FIntPoint(X, Y)))
+					{
+						NearbyCells.Add(Cell);
+					}
+				}
+			}
+
+		} else {
+
+			for (const TPair<FIntPoint, TArray<FPerceptionListenerID, TInlineAllocator<4>>>& Pair : Cells)
+			{
+				if (Pair.Key.X >= MinCell.X && Pair.Key.X <= MaxCell.X && Pair.Key.Y >= MinCell.Y && Pair.Key.Y <= MaxCell.Y)
+				{
+					NearbyCells.Add(&Pair.Value);
+				}
+			}
+
+		}
+
+		for (const TArray<FPerceptionListenerID, TInlineAllocator<4>>* Cell : NearbyCells)
+		{
+			for (const FPerceptionListenerID& ListenerID : *Cell)
+			{
+				FPerceptionListener* Listener = ListenersMap.Find(ListenerID);
+				const FListenerEntry* Entry = ListenerEntries.Find(ListenerID);
+
+				if (!Listener || !Entry)
+				{
+					continue;
+				}
+
+				const float DistanceSquared = FVector::DistSquared(Event.NoiseLocation, Listener->CachedLocation);
+
+				// louder noises carry further, up to the noise's own limit
+				if (DistanceSquared > FMath::Square(Entry->HearingRange * Event.Loudness))
+				{
+					continue;
+				}
+
+				if (Event.MaxRange > 0.0f && DistanceSquared > FMath::Square(Event.MaxRange))
+				{
+					continue;
+				}
+
+				if (!FAISenseAffiliationFilter::ShouldSenseTeam(Listener->TeamIdentifier, Event.TeamIdentifier, Entry->AffiliationFlags))
+				{
+					continue;
+				}
+
+				Listener->RegisterStimulus(Event.Instigator, FAIStimulus(*this, Event.Loudness, Event.NoiseLocation, Listener->CachedLocation, FAIStimulus::SensingSucceeded, Event.Tag));
+			}
+		}
+	}
+
+	NoiseEvents.Reset();
+
+	// noises wake us up when they come in
+	return SuspendNextUpdate;
+}
+
+void UShooterAISense_Hearing::OnNewListenerImpl(const FPerceptionListener& NewListener)
+{
+	const UAIPerceptionComponent* PerceptionComponent = NewListener.Listener.Get();
+	const UShooterAISenseConfig_Hearing* Config = PerceptionComponent ? Cast<const UShooterAISenseConfig_Hearing>(PerceptionComponent->GetSenseConfig(GetSenseID())) : nullptr;
+
+	if (!Config)
+	{
+		return;
+	}
+
+	FListenerEntry& Entry = ListenerEntries.Add(NewListener.GetListenerID());
+	Entry.Cell = GetCell(NewListener.CachedLocation);
+	Entry.HearingRange = Config->HearingRange;
+	Entry.AffiliationFlags = Config->DetectionByAffiliation.GetAsFlags();
+
+	Cells.FindOrAdd(Entry.Cell).Add(NewListener.GetListenerID());
+
+	MaxHearingRange = FMath::Max(MaxHearingRange, Entry.HearingRange);
+}
+
+void UShooterAISense_Hearing::OnListenerUpdateImpl(const FPerceptionListener& UpdatedListener)
+{
+	// refile the listener with its new config, if it still has this sense
+	RemoveListener(UpdatedListener.GetListenerID());
+
+	if (UpdatedListener.HasSense(GetSenseID()))
+	{
+		OnNewListenerImpl(UpdatedListener);
+	}
+
+	UpdateMaxHearingRange();
+}
+
+void UShooterAISense_Hearing::OnListenerRemovedImpl(const FPerceptionListener& RemovedListener)
+{
+	RemoveListener(RemovedListener.GetListenerID());
+
+	UpdateMaxHearingRange();
+}
+
+void UShooterAISense_Hearing::RefreshListenerCells(const AIPerception::FListenerMap& ListenersMap)
+{
+	for (TPair<FPerceptionListenerID, FListenerEntry>& Pair : ListenerEntries)
+	{
+		const FPerceptionListener* Listener = ListenersMap.Find(Pair.Key);
+
+		if (!Listener)
+		{
+			continue;
+		}
+
+		const FIntPoint NewCell = GetCell(Listener->CachedLocation);
+
+		// most listeners stay in their cell between noises
+		if (NewCell == Pair.Value.Cell)
+		{
+			continue;
+		}
+
+		if (TArray<FPerceptionListenerID, TInlineAllocator<4>>* OldCell = Cells.Find(Pair.Value.Cell))
+		{
+			OldCell->RemoveSwap(Pair.Key, EAllowShrinking::No);
+
+			if (OldCell->Num() == 0)
+			{
+				Cells.Remove(Pair.Value.Cell);
+			}
+		}
+
+		Cells.FindOrAdd(NewCell).Add(Pair.Key);
+		Pair.Value.Cell = NewCell;
+	}
+}
+
+void UShooterAISense_Hearing::RemoveListener(const FPerceptionListenerID& ListenerID)
+{
+	FListenerEntry Entry;
+
+	if (!ListenerEntries.RemoveAndCopyValue(ListenerID, Entry))
+	{
+		return;
+	}
+
+	if (TArray<FPerceptionListenerID, TInlineAllocator<4>>* Cell = Cells.Find(Entry.Cell))
+	{
+		Cell->RemoveSwap(ListenerID, EAllowShrinking::No);
+
+		if (Cell->Num() == 0)
+		{
+			Cells.Remove(Entry.Cell);
+		}
+	}
+}
+
+void UShooterAISense_Hearing::UpdateMaxHearingRange()
+{
+	MaxHearingRange = 0.0f;
+
+	for (const TPair<FPerceptionListenerID, FListenerEntry>& Pair : ListenerEntries)
+	{
+		MaxHearingRange = FMath::Max(MaxHearingRange, Pair.Value.HearingRange);
+	}
+}
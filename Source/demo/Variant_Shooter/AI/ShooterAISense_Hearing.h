@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Perception/AISense.h"
+#include "Perception/AISense_Hearing.h"
+#include "ShooterAISense_Hearing.generated.h"
+
+/**
+ *  Hearing sense that only tests noises against nearby listeners
+ *  Listeners are kept in a 2D spatial hash. A listener's cell is updated when it has moved into another one,
+ *  and each noise only visits the cells within reach of the loudest listener
+ *  Listeners opt in with UShooterAISenseConfig_Hearing in their perception component
+ */
+UCLASS(ClassGroup=AI, config=Game)
+class DEMO_API UShooterAISense_Hearing : public UAISense
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Hearing properties of a listener, digested from its sense config */
+	struct FListenerEntry
+	{
+		/** Cell the listener is filed under */
+		FIntPoint Cell = FIntPoint::ZeroValue;
+
+		/** Hearing range for noises of loudness 1 */
+		float HearingRange = 0.0f;
+
+		/** Teams the listener hears, as affiliation flags */
+		uint8 AffiliationFlags = 0;
+	};
+
+	/** Size of the listener cells */
+	UPROPERTY(Config)
+	float CellSize = 1000.0f;
+
+	/** Noises reported since the last update */
+	TArray<FAINoiseEvent> NoiseEvents;
+
+	/** Listeners with this sense */
+	TMap<FPerceptionListenerID, FListenerEntry> ListenerEntries;
+
+	/** Listeners by cell */
+	TMap<FIntPoint, TArray<FPerceptionListenerID, TInlineAllocator<4>>> Cells;
+
+	/** Largest hearing range among the listeners */
+	float MaxHearingRange = 0.0f;
+
+public:
+
+	/** Constructor */
+	UShooterAISense_Hearing(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	/** Queues a noise for the next update */
+	void RegisterEvent(const FAINoiseEvent& Event);
+
+	/**
+	 * @brief Reports a noise to the shooter hearing sense
+	 * @param WorldContextObject object in the world the noise was made in
+	 * @param NoiseLocation where the noise was made
+	 * @param Loudness loudness of the noise. Scales the listeners' hearing range
+	 * @param Instigator actor the listeners perceive
+	 * @param MaxRange max hearing range regardless of loudness. Zero means unlimited
+	 * @param Tag noise tag passed on with the stimulus
+	 */
+	static void ReportNoiseEvent(UObject* WorldContextObject, const FVector& NoiseLocation, float Loudness, AActor* Instigator, float MaxRange, FName Tag);
+
+protected:
+
+	//~Begin UAISense interface
+	virtual float Update() override;
+	//~End UAISense interface
+
+	/** Files a new listener */
+	void OnNewListenerImpl(const FPerceptionListener& NewListener);
+
+	/** Refreshes a listener whose senses or config changed */
+	void OnListenerUpdateImpl(const FPerceptionListener& UpdatedListener);
+
+	/** Removes a listener */
+	void OnListenerRemovedImpl(const FPerceptionListener& RemovedListener);
+
+	/** Moves listeners that changed cells since the last update */
+	void RefreshListenerCells(const AIPerception::FListenerMap& ListenersMap);
+
+	/** Removes a listener from its cell and the entries */
+	void RemoveListener(const FPerceptionListenerID& ListenerID);
+
+	/** Recomputes the largest hearing range */
+	void UpdateMaxHearingRange();
+
+	/** Returns the cell containing a location */
+	FIntPoint GetCell(const FVector& Location) const
+	{
+		return FIntPoint(FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize));
+	}
+};
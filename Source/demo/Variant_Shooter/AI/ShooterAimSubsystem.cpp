@@ -0,0 +1,256 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/AI/ShooterAimSubsystem.h"
+#include "ShooterNPC.h"
+#include "Math/VectorRegister.h"
+#include "Engine/World.h"
+
+void UShooterAimSubsystem::Auth_AddShooter(AShooterNPC* Shooter)
+{
+	if (!Shooter || Entries.ContainsByPredicate([Shooter](const FAimEntry& Entry) { return Entry.Shooter.Get() == Shooter; }))
+	{
+		return;
+	}
+
+	FAimEntry& Entry = Entries.AddDefaulted_GetRef();
+	Entry.Shooter = Shooter;
+
+	// each shooter draws from its own stream, so its spread doesn't depend on who else is shooting
+	Entry.Stream.Initialize(static_cast<int32>(GetTypeHash(Shooter->GetFName())));
+}
+
+void UShooterAimSubsystem::Auth_RemoveShooter(AShooterNPC* Shooter)
+{
+	Entries.RemoveAllSwap([Shooter](const FAimEntry& Entry) { return Entry.Shooter.Get() == Shooter; }, EAllowShrinking::No);
+}
+
+bool UShooterAimSubsystem::ConsumeAimLocation(const AShooterNPC* Shooter, FVector& OutLocation)
+{
+	FAimEntry* Entry = Entries.FindByPredicate([Shooter](const FAimEntry& Entry) { return Entry.Shooter.Get() == Shooter; });
+
+	if (!Entry || !Entry->bHasSolution)
+	{
+		return false;
+	}
+
+	Entry->bHasSolution = false;
+
+	// the solution is only good for the target it was aimed at
+	if (GetWorld()->GetTimeSeconds() - Entry->SolutionTime > MaxSolutionAge || Entry->Target.Get() != Shooter->GetAimTarget())
+	{
+		return false;
+	}
+
+	// follow the target, or ourselves if we're not aiming at anything, since the solution was found
+	FShooterAimRequest Request;
+	Shooter->BuildAimRequest(Request);
+
+	OutLocation = (Request.bHasTarget ? Request.Target : Request.Source) + Entry->Solution;
+	return true;
+}
+
+bool UShooterAimSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterAimSubsystem::Tick(float DeltaTime)
+{
+	if (Entries.Num() == 0)
+	{
+		return;
+	}
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	// drop shooters that went away
+	Entries.RemoveAllSwap([](const FAimEntry& Entry)
+	{
+		const AShooterNPC* Shooter = Entry.Shooter.Get();
+		return !IsValid(Shooter) || Shooter->IsDead();
+	}, EAllowShrinking::No);
+
+	CollectTraces(Now);
+
+	// gather the shooters that need a new solution
+	TArray<int32, TInlineAllocator<32>> BatchEntries;
+	TArray<FShooterAimRequest, TInlineAllocator<32>> Requests;
+	TArray<FVector3f, TInlineAllocator<32>> Randoms;
+
+	for (int32 i = 0; i < Entries.Num(); ++i)
+	{
+		FAimEntry& Entry = Entries[i];
+		const AShooterNPC* Shooter = Entry.Shooter.Get();
+
+		// unused solutions stay good for a while
+		if (Entry.bHasSolution && Now - Entry.SolutionTime <= MaxSolutionAge && Entry.Target.Get() == Shooter->GetAimTarget())
+		{
+			continue;
+		}
+
+		Shooter->BuildAimRequest(Requests.AddDefaulted_GetRef());
+
+		// always draw in the same order so the stream stays deterministic
+		const float OffsetRandom = Entry.Stream.GetFraction();
+		const float ConeRandom = Entry.Stream.GetFraction();
+		const float RollRandom = Entry.Stream.GetFraction();
+
+		Randoms.Emplace(OffsetRandom, ConeRandom, RollRandom);
+
+		Entry.Target = Shooter->GetAimTarget();
+		Entry.bHasSolution = false;
+
+		BatchEntries.Add(i);
+	}
+
+	if (BatchEntries.Num() == 0)
+	{
+		return;
+	}
+
+	TArray<FVector> Directions;
+	SolveDirections(Requests, Randoms, Directions);
+
+	// resolve obstructions with async traces, collected next frame
+	for (int32 i = 0; i < BatchEntries.Num(); ++i)
+	{
+		FAimEntry& Entry = Entries[BatchEntries[i]];
+		const FShooterAimRequest& Request = Requests[i];
+
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ShooterAim), false, Entry.Shooter.Get());
+
+		Entry.TraceEnd = Request.Source + Directions[i] * Request.Range;
+		Entry.SolveAnchor = Request.bHasTarget ? Request.Target : Request.Source;
+		Entry.PendingTrace = GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, Request.Source, Entry.TraceEnd, ECC_Visibility, QueryParams);
+	}
+}
+
+TStatId UShooterAimSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterAimSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterAimSubsystem::CollectTraces(double Now)
+{
+	for (FAimEntry& Entry : Entries)
+	{
+		if (!Entry.PendingTrace.IsValid())
+		{
+			continue;
+		}
+
+		FTraceDatum Datum;
+		const bool bFound = GetWorld()->QueryTraceData(Entry.PendingTrace, Datum);
+
+		Entry.PendingTrace = FTraceHandle();
+
+		// the trace data only lives for a frame. If we missed it, the shooter gets solved again
+		if (!bFound)
+		{
+			continue;
+		}
+
+		const FHitResult* Hit = Datum.OutHits.FindByPredicate([](const FHitResult& Result) { return Result.bBlockingHit; });
+
+		// aim at the impact point or the trace end
+		Entry.Solution = (Hit ? Hit->ImpactPoint : Entry.TraceEnd) - Entry.SolveAnchor;
+		Entry.SolutionTime = Now;
+		Entry.bHasSolution = true;
+	}
+}
+
+void UShooterAimSubsystem::SolveDirections(TConstArrayView<FShooterAimRequest> Requests, TConstArrayView<FVector3f> Randoms, TArray<FVector>& OutDirections)
+{
+	enum EField
+	{
+		DeltaX, DeltaY, DeltaZ, MinOffsetZ, OffsetRangeZ, OffsetRandom, CosHalfAngle, ConeRandom, RollRandom, OutX, OutY, OutZ, NumFields
+	};
+
+	const int32 Num = Requests.Num();
+	const int32 Stride = Align(Num, 4);
+
+	// padding lanes stay zeroed and are never read back
+	Scratch.Reset();
+	Scratch.SetNumZeroed(NumFields * Stride);
+
+	auto Field = [this, Stride](EField Index) { return Scratch.GetData() + Index * Stride; };
+
+	for (int32 i = 0; i < Num; ++i)
+	{
+		const FShooterAimRequest& Request = Requests[i];
+
+		// without a target, spread around the facing instead
+		const FVector Delta = Request.bHasTarget ? Request.Target - Request.Source : Request.Forward;
+
+		Field(DeltaX)[i] = Delta.X;
+		Field(DeltaY)[i] = Delta.Y;
+		Field(DeltaZ)[i] = Delta.Z;
+		Field(MinOffsetZ)[i] = Request.bHasTarget ? Request.MinOffsetZ : 0.0f;
+		Field(OffsetRangeZ)[i] = Request.bHasTarget ? Request.MaxOffsetZ - Request.MinOffsetZ : 0.0f;
+		Field(OffsetRandom)[i] = Randoms[i].X;
+		Field(CosHalfAngle)[i] = FMath::Cos(FMath::DegreesToRadians(FMath::Clamp(Request.VarianceHalfAngle, 0.0f, 180.0f)));
+		Field(ConeRandom)[i] = Randoms[i].Y;
+		Field(RollRandom)[i] = Randoms[i].Z;
+	}
+
+	const VectorRegister4Float One = VectorOneFloat();
+	const VectorRegister4Float MinusOne = VectorSetFloat1(-1.0f);
+	const VectorRegister4Float Zero = VectorZeroFloat();
+	const VectorRegister4Float TwoPi = VectorSetFloat1(UE_TWO_PI);
+	const VectorRegister4Float MinLengthSquared = VectorSetFloat1(UE_SMALL_NUMBER);
+
+	for (int32 i = 0; i < Stride; i += 4)
+	{
+		// aim at the target with its vertical offset
+		const VectorRegister4Float OffsetZ = VectorMultiplyAdd(VectorLoadAligned(Field(OffsetRandom) + i), VectorLoadAligned(Field(OffsetRangeZ) + i), VectorLoadAligned(Field(MinOffsetZ) + i));
+
+		VectorRegister4Float X = VectorLoadAligned(Field(DeltaX) + i);
+		VectorRegister4Float Y = VectorLoadAligned(Field(DeltaY) + i);
+		VectorRegister4Float Z = VectorAdd(VectorLoadAligned(Field(DeltaZ) + i), OffsetZ);
+
+		const VectorRegister4Float LengthSquared = VectorMultiplyAdd(X, X, VectorMultiplyAdd(Y, Y, VectorMultiply(Z, Z)));
+		const VectorRegister4Float InvLength = VectorDivide(One, VectorSqrt(VectorMax(LengthSquared, MinLengthSquared)));
+
+		X = VectorMultiply(X, InvLength);
+		Y = VectorMultiply(Y, InvLength);
+		Z = VectorMultiply(Z, InvLength);
+
+		// sample the spherical cap around the aim direction uniformly
+		const VectorRegister4Float CosHalf = VectorLoadAligned(Field(CosHalfAngle) + i);
+		const VectorRegister4Float CosTheta = VectorSubtract(One, VectorMultiply(VectorLoadAligned(Field(ConeRandom) + i), VectorSubtract(One, CosHalf)));
+		const VectorRegister4Float SinTheta = VectorSqrt(VectorMax(VectorSubtract(One, VectorMultiply(CosTheta, CosTheta)), Zero));
+
+		const VectorRegister4Float Roll = VectorMultiply(VectorLoadAligned(Field(RollRandom) + i), TwoPi);
+
+		VectorRegister4Float SinRoll, CosRoll;
+		VectorSinCos(&SinRoll, &CosRoll, &Roll);
+
+		// branchless orthonormal basis around the aim direction
+		const VectorRegister4Float Sign = VectorSelect(VectorCompareGE(Z, Zero), One, MinusOne);
+		const VectorRegister4Float A = VectorDivide(MinusOne, VectorAdd(Sign, Z));
+		const VectorRegister4Float B = VectorMultiply(VectorMultiply(X, Y), A);
+
+		const VectorRegister4Float TangentX = VectorAdd(One, VectorMultiply(Sign, VectorMultiply(VectorMultiply(X, X), A)));
+		const VectorRegister4Float TangentY = VectorMultiply(Sign, B);
+		const VectorRegister4Float TangentZ = VectorNegate(VectorMultiply(Sign, X));
+
+		const VectorRegister4Float BitangentX = B;
+		const VectorRegister4Float BitangentY = VectorAdd(Sign, VectorMultiply(VectorMultiply(Y, Y), A));
+		const VectorRegister4Float BitangentZ = VectorNegate(Y);
+
+		const VectorRegister4Float U = VectorMultiply(SinTheta, CosRoll);
+		const VectorRegister4Float V = VectorMultiply(SinTheta, SinRoll);
+
+		VectorStoreAligned(VectorMultiplyAdd(BitangentX, V, VectorMultiplyAdd(TangentX, U, VectorMultiply(X, CosTheta))), Field(OutX) + i);
+		VectorStoreAligned(VectorMultiplyAdd(BitangentY, V, VectorMultiplyAdd(TangentY, U, VectorMultiply(Y, CosTheta))), Field(OutY) + i);
+		VectorStoreAligned(VectorMultiplyAdd(BitangentZ, V, VectorMultiplyAdd(TangentZ, U, VectorMultiply(Z, CosTheta))), Field(OutZ) + i);
+	}
+
+	OutDirections.SetNumUninitialized(Num);
+
+	for (int32 i = 0; i < Num; ++i)
+	{
+		OutDirections[i] = FVector(Field(OutX)[i], Field(OutY)[i], Field(OutZ)[i]);
+	}
+}
@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "ShooterAimSubsystem.generated.h"
+
+class AShooterNPC;
+
+/** Everything needed to aim one shot for an NPC */
+struct FShooterAimRequest
+{
+	/** Where the shot is aimed from */
+	FVector Source = FVector::ZeroVector;
+
+	/** Location to aim at before the vertical offset. Only used if bHasTarget is set */
+	FVector Target = FVector::ZeroVector;
+
+	/** Direction to aim in when there's no target */
+	FVector Forward = FVector::ForwardVector;
+
+	/** If true, the shot is aimed at Target instead of along Forward */
+	bool bHasTarget = false;
+
+	/** Half angle of the aim cone, in degrees */
+	float VarianceHalfAngle = 0.0f;
+
+	/** Minimum vertical offset applied to the target */
+	float MinOffsetZ = 0.0f;
+
+	/** Maximum vertical offset applied to the target */
+	float MaxOffsetZ = 0.0f;
+
+	/** Max aim distance */
+	float Range = 0.0f;
+};
+
+/**
+ *  Server-side aim solver for NPC shooters
+ *  Each frame, shooters without an aim solution are gathered into a batch. Their spread directions are computed
+ *  four at a time with SIMD math from per-shooter random streams, so a shooter's sequence doesn't depend on the batch.
+ *  Obstructions are resolved with async traces, and the results are picked up on the next frame for the next shot
+ *  Solutions are kept relative to the target, so they're resolved against where the target is when the shot is fired
+ */
+UCLASS(config=Game)
+class DEMO_API UShooterAimSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** A registered shooter */
+	struct FAimEntry
+	{
+		/** Shooting NPC */
+		TWeakObjectPtr<AShooterNPC> Shooter;
+
+		/** Target the solution was aimed at */
+		TWeakObjectPtr<AActor> Target;
+
+		/** Random stream for the spread and vertical offset */
+		FRandomStream Stream;
+
+		/** Async trace in flight */
+		FTraceHandle PendingTrace;
+
+		/** Unobstructed end of the pending trace */
+		FVector TraceEnd = FVector::ZeroVector;
+
+		/** Target location the pending trace was solved against, or the aim source if there was no target */
+		FVector SolveAnchor = FVector::ZeroVector;
+
+		/** Latest aim solution, relative to its anchor so it follows a moving target */
+		FVector Solution = FVector::ZeroVector;
+
+		/** Time the solution was resolved */
+		double SolutionTime = 0.0;
+
+		/** If true, Solution holds an unused aim location */
+		bool bHasSolution = false;
+	};
+
+	/** Max age of an aim solution before it's recomputed */
+	UPROPERTY(Config)
+	float MaxSolutionAge = 0.25f;
+
+	/** Registered shooters */
+	TArray<FAimEntry> Entries;
+
+	/** Structure of arrays scratch space for the batched spread kernel, padded to a multiple of 4 */
+	TArray<float, TAlignedHeapAllocator<16>> Scratch;
+
+public:
+
+	/** Starts solving aim for a shooting NPC */
+	void Auth_AddShooter(AShooterNPC* Shooter);
+
+	/** Stops solving aim for an NPC */
+	void Auth_RemoveShooter(AShooterNPC* Shooter);
+
+	/** Returns true and a fresh aim location for the NPC's current target, if one was solved. Each solution is used once */
+	bool ConsumeAimLocation(const AShooterNPC* Shooter, FVector& OutLocation);
+
+protected:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+
+	/** Picks up the results of last frame's traces */
+	void CollectTraces(double Now);
+
+	/**
+	 * @brief Computes spread directions for a batch of aim requests
+	 * @param Requests aim requests
+	 * @param Randoms three random numbers in [0, 1) per request: vertical offset, cone angle and cone roll
+	 * @param OutDirections unit aim directions, one per request
+	 */
+	void SolveDirections(TConstArrayView<FShooterAimRequest> Requests, TConstArrayView<FVector3f> Randoms, TArray<FVector>& OutDirections);
+};
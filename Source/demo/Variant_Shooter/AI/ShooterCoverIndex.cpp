@@ -0,0 +1,273 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/AI/ShooterCoverIndex.h"
+#include "Components/BoxComponent.h"
+#include "NavigationSystem.h"
+#include "Engine/World.h"
+#include "demo.h"
+
+uint16 FShooterCoverPoint::GetDirectionBit(const FVector& Direction)
+{
+	// round the yaw to the nearest direction. The mask wraps negative sectors around
+	const int32 Sector = FMath::RoundToInt(FMath::Atan2(Direction.Y, Direction.X) * NumDirections / UE_TWO_PI) & (NumDirections - 1);
+	return static_cast<uint16>(1 << Sector);
+}
+
+AShooterCoverIndex::AShooterCoverIndex()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	// create the bake bounds
+	BakeBounds = CreateDefaultSubobject<UBoxComponent>(TEXT("Bake Bounds"));
+	SetRootComponent(BakeBounds);
+
+	BakeBounds->SetBoxExtent(FVector(2500.0f, 2500.0f, 500.0f));
+	BakeBounds->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	BakeBounds->SetHiddenInGame(true);
+}
+
+void AShooterCoverIndex::GetCoverPointsInRadius(const FVector& Center, float Radius, TArray<int32>& OutIndices) const
+{
+	if (!HasBakedData())
+	{
+		return;
+	}
+
+	const FIntPoint MinCell = GetCell(Center - FVector(Radius));
+	const FIntPoint MaxCell = GetCell(Center + FVector(Radius));
+
+	const float RadiusSquared = FMath::Square(Radius);
+
+	for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+	{
+		for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+		{
+			const int32 Cell = Y * GridSize.X + X;
+
+			for (int32 i = CellStarts[Cell]; i < CellStarts[Cell + 1]; ++i)
+			{
+				if (FVector::DistSquared(CoverPoints[i].GetLocation(), Center) <= RadiusSquared)
+				{
+					OutIndices.Add(i);
+				}
+			}
+		}
+	}
+}
+
+const FShooterCoverPoint* AShooterCoverIndex::FindCoverPointAt(const FVector& Location, float Tolerance) const
+{
+	if (!HasBakedData() || !ContainsLocation(Location))
+	{
+		return nullptr;
+	}
+
+	const FIntPoint CellCoords = GetCell(Location);
+	const int32 Cell = CellCoords.Y * GridSize.X + CellCoords.X;
+
+	for (int32 i = CellStarts[Cell]; i < CellStarts[Cell + 1]; ++i)
+	{
+		if (FVector::DistSquared(CoverPoints[i].GetLocation(), Location) <= FMath::Square(Tolerance))
+		{
+			return &CoverPoints[i];
+		}
+	}
+
+	return nullptr;
+}
+
+bool AShooterCoverIndex::ContainsLocation(const FVector& Location) const
+{
+	const FVector2D Local = (FVector2D(Location) - GridOrigin) / BakedCellSize;
+
+	return Local.X >= 0.0f && Local.Y >= 0.0f && Local.X < GridSize.X && Local.Y < GridSize.Y;
+}
+
+bool AShooterCoverIndex::HasBakedData() const
+{
+	// bakes from before the cell size was saved can't be read back
+	return BakedCellSize > 0.0f && CellStarts.Num() == GridSize.X * GridSize.Y + 1;
+}
+
+void AShooterCoverIndex::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// the grid keeps working with the size it was baked with, but the settings no longer match it
+	if (!HasBakedData() || BakedCellSize != CellSize)
+	{
+		UE_LOG(Logdemo, Warning, TEXT("'%s' cover bake is missing or stale. Rebake the cover points."), *GetNameSafe(this));
+	}
+}
+
+FIntPoint AShooterCoverIndex::GetCell(const FVector& Location) const
+{
+	const FVector2D Local = (FVector2D(Location) - GridOrigin) / BakedCellSize;
+
+	return FIntPoint(
+		FMath::Clamp(FMath::FloorToInt(Local.X), 0, GridSize.X - 1),
+		FMath::Clamp(FMath::FloorToInt(Local.Y), 0, GridSize.Y - 1));
+}
+
+#if WITH_EDITOR
+
+void AShooterCoverIndex::BakeCoverPoints()
+{
+	UWorld* World = GetWorld();
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+
+	if (!NavSys)
+	{
+		UE_LOG(Logdemo, Error, TEXT("'%s' can't bake cover without a navigation system."), *GetNameSafe(this));
+		return;
+	}
+
+	Modify();
+
+	const FBox Box = BakeBounds->Bounds.GetBox();
+
+	// only static geometry makes for cover, so ignore pawns and other dynamic actors placed in the level
+	const FCollisionObjectQueryParams ObjectParams(ECC_WorldStatic);
+	const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ShooterCoverBake), false, this);
+
+	// precompute the probe directions
+	FVector Directions[FShooterCoverPoint::NumDirections];
+
+	for (int32 d = 0; d < FShooterCoverPoint::NumDirections; ++d)
+	{
+		const float Angle = UE_TWO_PI * d / FShooterCoverPoint::NumDirections;
+		Directions[d] = FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.0f);
+	}
+
+	TArray<FShooterCoverPoint> NewPoints;
+	TSet<FIntVector> SampledLocations;
+
+	// a shallow projection per sample layer finds every floor instead of just the one nearest the middle of the box
+	const FVector ProjectExtent(SampleSpacing * 0.5f, SampleSpacing * 0.5f, SampleHeightSpacing * 0.5f);
+
+	for (float X = Box.Min.X; X <= Box.Max.X; X += SampleSpacing)
+	{
+		for (float Y = Box.Min.Y; Y <= Box.Max.Y; Y += SampleSpacing)
+		{
+			for (float Z = Box.Min.Z; Z <= Box.Max.Z; Z += SampleHeightSpacing)
+			{
+				FNavLocation NavLocation;
+
+				if (!NavSys->ProjectPointToNavigation(FVector(X, Y, Z), NavLocation, ProjectExtent))
+				{
+					continue;
+				}
+
+				// samples near the navmesh edges can snap to the same spot
+				const FIntVector SampleKey(FMath::RoundToInt(NavLocation.Location.X * 2.0f / SampleSpacing), FMath::RoundToInt(NavLocation.Location.Y * 2.0f / SampleSpacing), FMath::RoundToInt(NavLocation.Location.Z / 100.0f));
+
+				bool bAlreadySampled = false;
+				SampledLocations.Add(SampleKey, &bAlreadySampled);
+
+				if (bAlreadySampled)
+				{
+					continue;
+				}
+
+				FShooterCoverPoint Point;
+
+				float NearestWall = UE_BIG_NUMBER;
+				int32 NearestDirection = INDEX_NONE;
+
+				for (int32 d = 0; d < FShooterCoverPoint::NumDirections; ++d)
+				{
+					// a nearby wall at chest height covers us from this direction
+					const FVector CoverStart = NavLocation.Location + FVector(0.0f, 0.0f, CoverProbeHeight);
+
+					FHitResult Hit;
+
+					if (World->LineTraceSingleByObjectType(Hit, CoverStart, CoverStart + Directions[d] * CoverProbeDistance, ObjectParams, QueryParams))
+					{
+						Point.CoveredDirections |= 1 << d;
+
+						if (Hit.Distance < NearestWall)
+						{
+							NearestWall = Hit.Distance;
+							NearestDirection = d;
+						}
+					}
+
+					// an unobstructed view at eye height lets us peek in this direction
+					const FVector PeekStart = NavLocation.Location + FVector(0.0f, 0.0f, PeekProbeHeight);
+
+					if (!World->LineTraceTestByObjectType(PeekStart, PeekStart + Directions[d] * PeekProbeDistance, ObjectParams, QueryParams))
+					{
+						Point.PeekDirections |= 1 << d;
+					}
+				}
+
+				// nothing to hide behind
+				if (NearestDirection == INDEX_NONE)
+				{
+					continue;
+				}
+
+				// measure the cover by raising the trace until it clears the wall
+				float CoverHeight = CoverProbeHeight;
+
+				while (CoverHeight < FShooterCoverPoint::HeightUnit * MAX_uint8)
+				{
+					const FVector Start = NavLocation.Location + FVector(0.0f, 0.0f, CoverHeight + FShooterCoverPoint::HeightUnit * 5.0f);
+
+					if (!World->LineTraceTestByObjectType(Start, Start + Directions[NearestDirection] * CoverProbeDistance, ObjectParams, QueryParams))
+					{
+						break;
+					}
+
+					CoverHeight += FShooterCoverPoint::HeightUnit * 5.0f;
+				}
+
+				Point.Location = FVector3f(NavLocation.Location);
+				Point.NavPoly = NavLocation.NodeRef;
+				Point.FacingYaw = FRotator::CompressAxisToShort(Directions[NearestDirection].Rotation().Yaw);
+				Point.Height = static_cast<uint8>(FMath::Min(FMath::RoundToInt(CoverHeight / FShooterCoverPoint::HeightUnit), static_cast<int32>(MAX_uint8)));
+
+				NewPoints.Add(Point);
+			}
+		}
+	}
+
+	// lay out the grid over the bake bounds
+	BakedCellSize = CellSize;
+	GridOrigin = FVector2D(Box.Min);
+	GridSize = FIntPoint(FMath::Max(1, FMath::CeilToInt(Box.GetSize().X / BakedCellSize)), FMath::Max(1, FMath::CeilToInt(Box.GetSize().Y / BakedCellSize)));
+
+	// sort the points by cell so each cell is a contiguous range
+	TArray<int32> PointCells;
+	PointCells.Reserve(NewPoints.Num());
+
+	CellStarts.Init(0, GridSize.X * GridSize.Y + 1);
+
+	for (const FShooterCoverPoint& Point : NewPoints)
+	{
+		const FIntPoint CellCoords = GetCell(Point.GetLocation());
+		const int32 Cell = CellCoords.Y * GridSize.X + CellCoords.X;
+
+		PointCells.Add(Cell);
+		++CellStarts[Cell + 1];
+	}
+
+	for (int32 Cell = 1; Cell < CellStarts.Num(); ++Cell)
+	{
+		CellStarts[Cell] += CellStarts[Cell - 1];
+	}
+
+	TArray<int32> CellCursors(CellStarts.GetData(), GridSize.X * GridSize.Y);
+
+	CoverPoints.SetNum(NewPoints.Num());
+
+	for (int32 i = 0; i < NewPoints.Num(); ++i)
+	{
+		CoverPoints[CellCursors[PointCells[i]]++] = NewPoints[i];
+	}
+
+	UE_LOG(Logdemo, Log, TEXT("'%s' baked %d cover points."), *GetNameSafe(this), CoverPoints.Num());
+}
+
+#endif
@@ -0,0 +1,168 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "ShooterCoverIndex.generated.h"
+
+class UBoxComponent;
+
+/**
+ *  Compact cover point baked from the level
+ */
+USTRUCT()
+struct FShooterCoverPoint
+{
+	GENERATED_BODY()
+
+	/** Number of directions tracked by the direction bits */
+	static constexpr int32 NumDirections = 16;
+
+	/** Size of a cover height unit, in cm */
+	static constexpr float HeightUnit = 4.0f;
+
+	/** Location on the navmesh */
+	UPROPERTY()
+	FVector3f Location = FVector3f::ZeroVector;
+
+	/** Navmesh poly the point lies on */
+	UPROPERTY()
+	uint64 NavPoly = 0;
+
+	/** Yaw towards the cover, quantized to 16 bits */
+	UPROPERTY()
+	uint16 FacingYaw = 0;
+
+	/** Height of the cover, in height units */
+	UPROPERTY()
+	uint8 Height = 0;
+
+	/** Bit per direction set if the point is covered from that direction */
+	UPROPERTY()
+	uint16 CoveredDirections = 0;
+
+	/** Bit per direction set if a standing NPC can see out in that direction */
+	UPROPERTY()
+	uint16 PeekDirections = 0;
+
+	/** Returns the location as a double precision vector */
+	FVector GetLocation() const { return FVector(Location); }
+
+	/** Returns the direction towards the cover */
+	FVector GetFacing() const { return FRotator(0.0f, FRotator::DecompressAxisFromShort(FacingYaw), 0.0f).Vector(); }
+
+	/** Returns the cover height, in cm */
+	float GetHeight() const { return Height * HeightUnit; }
+
+	/** Returns the direction bit for a world direction */
+	static uint16 GetDirectionBit(const FVector& Direction);
+
+	/** Returns true if the point is covered from a world location */
+	bool IsCoveredFrom(const FVector& ThreatLocation) const { return (CoveredDirections & GetDirectionBit(ThreatLocation - GetLocation())) != 0; }
+
+	/** Returns true if a standing NPC at the point can see out towards a world location */
+	bool CanPeekAt(const FVector& ThreatLocation) const { return (PeekDirections & GetDirectionBit(ThreatLocation - GetLocation())) != 0; }
+};
+
+/**
+ *  Baked cover point index for a part of the level
+ *  Cover points are extracted offline from the navmesh and level collision inside the bake bounds,
+ *  along with per-direction cover and peek bits, and stored in a flat grid for fast radius lookups
+ *  EQS cover queries read the index instead of sampling and tracing points at runtime
+ */
+UCLASS()
+class DEMO_API AShooterCoverIndex : public AActor
+{
+	GENERATED_BODY()
+
+	/** Bounds of the baked area */
+	UPROPERTY(VisibleAnywhere, Category="Components", meta = (AllowPrivateAccess = "true"))
+	UBoxComponent* BakeBounds;
+
+protected:
+
+	/** Distance between navmesh samples while baking */
+	UPROPERTY(EditAnywhere, Category="Cover|Bake", meta = (ClampMin = 25, ClampMax = 500, Units = "cm"))
+	float SampleSpacing = 100.0f;
+
+	/** Vertical distance between sample layers while baking. Each layer only snaps to navmesh within half of this, so stacked floors are sampled separately */
+	UPROPERTY(EditAnywhere, Category="Cover|Bake", meta = (ClampMin = 25, ClampMax = 500, Units = "cm"))
+	float SampleHeightSpacing = 100.0f;
+
+	/** Max distance to a wall for a point to count as cover */
+	UPROPERTY(EditAnywhere, Category="Cover|Bake", meta = (ClampMin = 10, ClampMax = 300, Units = "cm"))
+	float CoverProbeDistance = 80.0f;
+
+	/** Height above the navmesh of the trace that decides if a point is covered. Roughly a crouched NPC's chest */
+	UPROPERTY(EditAnywhere, Category="Cover|Bake", meta = (ClampMin = 10, ClampMax = 200, Units = "cm"))
+	float CoverProbeHeight = 60.0f;
+
+	/** Height above the navmesh of the trace that decides if a point can peek. Roughly a standing NPC's eyes */
+	UPROPERTY(EditAnywhere, Category="Cover|Bake", meta = (ClampMin = 50, ClampMax = 300, Units = "cm"))
+	float PeekProbeHeight = 150.0f;
+
+	/** Length of the peek traces */
+	UPROPERTY(EditAnywhere, Category="Cover|Bake", meta = (ClampMin = 100, ClampMax = 10000, Units = "cm"))
+	float PeekProbeDistance = 1500.0f;
+
+	/** Size of the index grid cells. Only takes effect on the next bake */
+	UPROPERTY(EditAnywhere, Category="Cover|Bake", meta = (ClampMin = 100, ClampMax = 5000, Units = "cm"))
+	float CellSize = 1000.0f;
+
+	/** Baked cover points, sorted by cell */
+	UPROPERTY()
+	TArray<FShooterCoverPoint> CoverPoints;
+
+	/** Cell size the grid was baked with */
+	UPROPERTY()
+	float BakedCellSize = 0.0f;
+
+	/** First cover point of each cell, with one extra entry past the last cell */
+	UPROPERTY()
+	TArray<int32> CellStarts;
+
+	/** World XY of the grid's min corner */
+	UPROPERTY()
+	FVector2D GridOrigin = FVector2D::ZeroVector;
+
+	/** Number of cells along X and Y */
+	UPROPERTY()
+	FIntPoint GridSize = FIntPoint::ZeroValue;
+
+public:
+
+	/** Constructor */
+	AShooterCoverIndex();
+
+	/** Returns the indices of the cover points within a radius */
+	void GetCoverPointsInRadius(const FVector& Center, float Radius, TArray<int32>& OutIndices) const;
+
+	/** Returns the cover point at a location, or nullptr */
+	const FShooterCoverPoint* FindCoverPointAt(const FVector& Location, float Tolerance = 1.0f) const;
+
+	/** Returns a cover point by index */
+	const FShooterCoverPoint& GetCoverPoint(int32 Index) const { return CoverPoints[Index]; }
+
+	/** Returns true if the location is inside the baked grid */
+	bool ContainsLocation(const FVector& Location) const;
+
+	/** Returns true if there's baked grid data to read */
+	bool HasBakedData() const;
+
+#if WITH_EDITOR
+
+	/** Extracts cover points from the navmesh and collision inside the bake bounds */
+	UFUNCTION(CallInEditor, Category="Cover")
+	void BakeCoverPoints();
+
+#endif
+
+protected:
+
+	/** Warns about stale bakes */
+	virtual void BeginPlay() override;
+
+	/** Returns the grid cell for a location, clamped to the grid */
+	FIntPoint GetCell(const FVector& Location) const;
+};
@@ -0,0 +1,319 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/AI/ShooterInfluenceMapSubsystem.h"
+#include "GenericTeamAgentInterface.h"
+#include "NavMesh/NavMeshBoundsVolume.h"
+#include "Math/VectorRegister.h"
+#include "EngineUtils.h"
+#include "Engine/World.h"
+
+void UShooterInfluenceMapSubsystem::Auth_ReportShot(const AActor* Shooter, const FVector& Location, float Loudness)
+{
+	if (!IsInitialized())
+	{
+		return;
+	}
+
+	const uint8 Team = FGenericTeamId::GetTeamIdentifier(Shooter).GetId();
+
+	if (Team < MaxTeams)
+	{
+		Stamp(Team, Location, ShotThreatRadius, ShotThreat);
+	}
+
+	Stamp(NoiseLayer, Location, NoiseRadius, Loudness);
+}
+
+void UShooterInfluenceMapSubsystem::Auth_ReportNoise(const FVector& Location, float Loudness)
+{
+	if (IsInitialized())
+	{
+		Stamp(NoiseLayer, Location, NoiseRadius, Loudness);
+	}
+}
+
+void UShooterInfluenceMapSubsystem::Auth_ReportDamage(const AActor* Victim, float Damage, const AActor* Instigator)
+{
+	if (!IsInitialized() || !Victim)
+	{
+		return;
+	}
+
+	Stamp(DamageLayer, Victim->GetActorLocation(), DamageRadius, Damage);
+
+	// whoever landed the hit is a threat where they stand
+	if (Instigator)
+	{
+		const uint8 Team = FGenericTeamId::GetTeamIdentifier(Instigator).GetId();
+
+		if (Team < MaxTeams)
+		{
+			Stamp(Team, Instigator->GetActorLocation(), ShotThreatRadius, ShotThreat);
+		}
+	}
+}
+
+void UShooterInfluenceMapSubsystem::Auth_ReportDeath(const FVector& Location)
+{
+	if (IsInitialized())
+	{
+		Stamp(DamageLayer, Location, DeathRadius, DeathDamage);
+	}
+}
+
+float UShooterInfluenceMapSubsystem::GetThreat(const FVector& Location, uint8 Team) const
+{
+	const int32 Cell = GetCell(Location);
+
+	return Cell != INDEX_NONE ? GetThreatAtCell(Cell, Team) : 0.0f;
+}
+
+float UShooterInfluenceMapSubsystem::GetDamage(const FVector& Location) const
+{
+	const int32 Cell = GetCell(Location);
+
+	return Cell != INDEX_NONE ? GetValue(DamageLayer, Cell) : 0.0f;
+}
+
+float UShooterInfluenceMapSubsystem::GetNoise(const FVector& Location) const
+{
+	const int32 Cell = GetCell(Location);
+
+	return Cell != INDEX_NONE ? GetValue(NoiseLayer, Cell) : 0.0f;
+}
+
+bool UShooterInfluenceMapSubsystem::FindLocation(EShooterInfluenceQuery Query, const FVector& Origin, float Radius, const FVector& Querier, uint8 Team, FVector& OutLocation) const
+{
+	if (!IsInitialized())
+	{
+		return false;
+	}
+
+	const FVector2D Local = (FVector2D(Origin) - GridOrigin) / CellSize;
+	const int32 CellRadius = FMath::CeilToInt(Radius / CellSize);
+
+	const int32 MinX = FMath::Max(0, FMath::FloorToInt(Local.X) - CellRadius);
+	const int32 MaxX = FMath::Min(GridSize.X - 1, FMath::FloorToInt(Local.X) + CellRadius);
+	const int32 MinY = FMath::Max(0, FMath::FloorToInt(Local.Y) - CellRadius);
+	const int32 MaxY = FMath::Min(GridSize.Y - 1, FMath::FloorToInt(Local.Y) + CellRadius);
+
+	// flanks are off to the side of the line from the origin to the querier
+	const FVector2D QuerierDir = (FVector2D(Querier) - FVector2D(Origin)).GetSafeNormal();
+
+	float BestScore = UE_BIG_NUMBER;
+	float BestDistanceSquared = UE_BIG_NUMBER;
+	bool bFound = false;
+
+	for (int32 Y = MinY; Y <= MaxY; ++Y)
+	{
+		for (int32 X = MinX; X <= MaxX; ++X)
+		{
+			const FVector2D CellCenter = GridOrigin + FVector2D(X + 0.5f, Y + 0.5f) * CellSize;
+			const FVector2D Offset = CellCenter - FVector2D(Origin);
+			const float OffsetSize = Offset.Size();
+
+			if (OffsetSize > Radius)
+			{
+				continue;
+			}
+
+			const int32 Cell = Y * GridSize.X + X;
+
+			// lower scores are better
+			float Score = 0.0f;
+
+			switch (Query)
+			{
+			case EShooterInfluenceQuery::Retreat:
+				Score = GetThreatAtCell(Cell, Team) + GetValue(DamageLayer, Cell);
+				break;
+
+			case EShooterInfluenceQuery::Flank:
+			{
+				// stay on the outer ring, between 60 and 120 degrees off the querier's line
+				const float SideDot = FVector2D::DotProduct(Offset / FMath::Max(OffsetSize, UE_KINDA_SMALL_NUMBER), QuerierDir);
+
+				if (OffsetSize < Radius * 0.5f || FMath::Abs(SideDot) > 0.5f)
+				{
+					continue;
+				}
+
+				Score = GetThreatAtCell(Cell, Team) + GetValue(DamageLayer, Cell);
+				break;
+			}
+
+			case EShooterInfluenceQuery::Investigate:
+			{
+				const float Noise = GetValue(NoiseLayer, Cell);
+
+				// nothing to investigate here
+				if (Noise <= 0.0f)
+				{
+					continue;
+				}
+
+				Score = -Noise;
+				break;
+			}
+			}
+
+			// break ties by staying close to the querier
+			const float DistanceSquared = FVector2D::DistSquared(CellCenter, FVector2D(Querier));
+
+			if (Score < BestScore - UE_KINDA_SMALL_NUMBER || (FMath::IsNearlyEqual(Score, BestScore, UE_KINDA_SMALL_NUMBER) && DistanceSquared < BestDistanceSquared))
+			{
+				BestScore = Score;
+				BestDistanceSquared = DistanceSquared;
+				OutLocation = FVector(CellCenter, Origin.Z);
+				bFound = true;
+			}
+		}
+	}
+
+	return bFound;
+}
+
+bool UShooterInfluenceMapSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterInfluenceMapSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// only the server's AI reads the map
+	if (InWorld.GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	// fit the grid to the navigable area, since that's where the NPCs are
+	FBox Bounds(ForceInit);
+
+	for (TActorIterator<ANavMeshBoundsVolume> It(&InWorld); It; ++It)
+	{
+		Bounds += It->GetComponentsBoundingBox(true);
+	}
+
+	if (!Bounds.IsValid)
+	{
+		Bounds = FBox(FVector(-DefaultHalfExtent), FVector(DefaultHalfExtent));
+	}
+
+	GridOrigin = FVector2D(Bounds.Min);
+	GridSize = FIntPoint(FMath::Max(1, FMath::CeilToInt(Bounds.GetSize().X / CellSize)), FMath::Max(1, FMath::CeilToInt(Bounds.GetSize().Y / CellSize)));
+
+	// pad each layer to whole vector registers so the decay pass never needs a scalar tail
+	LayerStride = Align(GridSize.X * GridSize.Y, 4);
+
+	Layers.SetNumZeroed(LayerStride * NumLayers);
+}
+
+void UShooterInfluenceMapSubsystem::Tick(float DeltaTime)
+{
+	if (!IsInitialized())
+	{
+		return;
+	}
+
+	TimeSinceDecay += DeltaTime;
+
+	if (TimeSinceDecay < DecayInterval)
+	{
+		return;
+	}
+
+	// decay by the actual elapsed time so the half lives hold at any frame rate
+	for (int32 Team = 0; Team < MaxTeams; ++Team)
+	{
+		DecayLayer(Team, FMath::Pow(0.5f, TimeSinceDecay / ThreatHalfLife));
+	}
+
+	DecayLayer(DamageLayer, FMath::Pow(0.5f, TimeSinceDecay / DamageHalfLife));
+	DecayLayer(NoiseLayer, FMath::Pow(0.5f, TimeSinceDecay / NoiseHalfLife));
+
+	TimeSinceDecay = 0.0f;
+}
+
+TStatId UShooterInfluenceMapSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterInfluenceMapSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterInfluenceMapSubsystem::DecayLayer(int32 Layer, float Factor)
+{
+	float* Data = Layers.GetData() + Layer * LayerStride;
+
+	const VectorRegister4Float FactorVector = VectorSetFloat1(Factor);
+	const VectorRegister4Float ZeroThreshold = VectorSetFloat1(UE_KINDA_SMALL_NUMBER);
+
+	for (int32 i = 0; i < LayerStride; i += 4)
+	{
+		const VectorRegister4Float Decayed = VectorMultiply(VectorLoadAligned(Data + i), FactorVector);
+
+		// flush values that have faded out, so they don't linger as denormals
+		VectorStoreAligned(VectorSelect(VectorCompareGT(Decayed, ZeroThreshold), Decayed, VectorZeroFloat()), Data + i);
+	}
+}
+
+void UShooterInfluenceMapSubsystem::Stamp(int32 Layer, const FVector& Location, float Radius, float Amount)
+{
+	const FVector2D Local = (FVector2D(Location) - GridOrigin) / CellSize;
+	const int32 CellRadius = FMath::CeilToInt(Radius / CellSize);
+
+	const int32 MinX = FMath::Max(0, FMath::FloorToInt(Local.X) - CellRadius);
+	const int32 MaxX = FMath::Min(GridSize.X - 1, FMath::FloorToInt(Local.X) + CellRadius);
+	const int32 MinY = FMath::Max(0, FMath::FloorToInt(Local.Y) - CellRadius);
+	const int32 MaxY = FMath::Min(GridSize.Y - 1, FMath::FloorToInt(Local.Y) + CellRadius);
+
+	float* Data = Layers.GetData() + Layer * LayerStride;
+
+	for (int32 Y = MinY; Y <= MaxY; ++Y)
+	{
+		for (int32 X = MinX; X <= MaxX; ++X)
+		{
+			const float Distance = FVector2D::Distance(FVector2D(X + 0.5f, Y + 0.5f), Local) * CellSize;
+
+			// linear falloff to the edge of the radius
+			if (Distance < Radius)
+			{
+				Data[Y * GridSize.X + X] += Amount * (1.0f - Distance / Radius);
+			}
+		}
+	}
+}
+
+int32 UShooterInfluenceMapSubsystem::GetCell(const FVector& Location) const
+{
+	if (!IsInitialized())
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 X = FMath::FloorToInt((Location.X - GridOrigin.X) / CellSize);
+	const int32 Y = FMath::FloorToInt((Location.Y - GridOrigin.Y) / CellSize);
+
+	if (X < 0 || Y < 0 || X >= GridSize.X || Y >= GridSize.Y)
+	{
+		return INDEX_NONE;
+	}
+
+	return Y * GridSize.X + X;
+}
+
+float UShooterInfluenceMapSubsystem::GetThreatAtCell(int32 Cell, uint8 Team) const
+{
+	float Threat = 0.0f;
+
+	for (int32 OtherTeam = 0; OtherTeam < MaxTeams; ++OtherTeam)
+	{
+		if (FGenericTeamId::GetAttitude(FGenericTeamId(OtherTeam), FGenericTeamId(Team)) == ETeamAttitude::Hostile)
+		{
+			Threat += GetValue(OtherTeam, Cell);
+		}
+	}
+
+	return Threat;
+}
@@ -0,0 +1,174 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterInfluenceMapSubsystem.generated.h"
+
+/**
+ *  Tactical questions that can be asked of the influence map
+ */
+UENUM(BlueprintType)
+enum class EShooterInfluenceQuery : uint8
+{
+	/** Least threatened and least damaged place around the origin */
+	Retreat,
+
+	/** Least threatened place around the origin, off to the side of the line between the origin and the querier */
+	Flank,
+
+	/** Noisiest place around the origin */
+	Investigate
+};
+
+/**
+ *  Server-side tactical influence map
+ *  Keeps a coarse 2D grid over the level with threat per team, recent damage and recent noise
+ *  The grid is stamped incrementally from gameplay events and decays over time in vectorized passes,
+ *  so NPCs can answer retreat, flank and investigate questions with a grid scan instead of searching over every combatant
+ */
+UCLASS(config=Game)
+class DEMO_API UShooterInfluenceMapSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Number of teams with their own threat layer. Teams past this aren't tracked */
+	static constexpr int32 MaxTeams = 4;
+
+	/** Layer holding recent damage */
+	static constexpr int32 DamageLayer = MaxTeams;
+
+	/** Layer holding recent noise */
+	static constexpr int32 NoiseLayer = MaxTeams + 1;
+
+	/** Total number of layers */
+	static constexpr int32 NumLayers = MaxTeams + 2;
+
+	/** Size of a grid cell */
+	UPROPERTY(Config)
+	float CellSize = 400.0f;
+
+	/** Half size of the grid if the level has no navmesh bounds to fit it to */
+	UPROPERTY(Config)
+	float DefaultHalfExtent = 20000.0f;
+
+	/** Time for threat to decay to half its value */
+	UPROPERTY(Config)
+	float ThreatHalfLife = 4.0f;
+
+	/** Time for damage to decay to half its value */
+	UPROPERTY(Config)
+	float DamageHalfLife = 6.0f;
+
+	/** Time for noise to decay to half its value */
+	UPROPERTY(Config)
+	float NoiseHalfLife = 2.0f;
+
+	/** Time between decay passes */
+	UPROPERTY(Config)
+	float DecayInterval = 0.25f;
+
+	/** Threat stamped by a shot */
+	UPROPERTY(Config)
+	float ShotThreat = 1.0f;
+
+	/** Radius of the threat stamped by a shot */
+	UPROPERTY(Config)
+	float ShotThreatRadius = 1500.0f;
+
+	/** Radius of the noise stamped at a noise's source */
+	UPROPERTY(Config)
+	float NoiseRadius = 800.0f;
+
+	/** Radius of the damage stamped by a hit */
+	UPROPERTY(Config)
+	float DamageRadius = 600.0f;
+
+	/** Radius of the damage stamped by a death */
+	UPROPERTY(Config)
+	float DeathRadius = 1000.0f;
+
+	/** Damage stamped by a death */
+	UPROPERTY(Config)
+	float DeathDamage = 100.0f;
+
+	/** All layers back to back, each padded to a whole number of vector registers */
+	TArray<float, TAlignedHeapAllocator<16>> Layers;
+
+	/** World XY of the grid's min corner */
+	FVector2D GridOrigin = FVector2D::ZeroVector;
+
+	/** Number of cells along X and Y */
+	FIntPoint GridSize = FIntPoint::ZeroValue;
+
+	/** Number of floats in each layer, including padding */
+	int32 LayerStride = 0;
+
+	/** Time accumulated towards the next decay pass */
+	float TimeSinceDecay = 0.0f;
+
+public:
+
+	/** Stamps a shot: threat for the shooter's team around the shooter, and noise */
+	void Auth_ReportShot(const AActor* Shooter, const FVector& Location, float Loudness);
+
+	/** Stamps noise, e.g. from an impact */
+	void Auth_ReportNoise(const FVector& Location, float Loudness);
+
+	/** Stamps damage around the victim, and threat for the instigator's team around the instigator */
+	void Auth_ReportDamage(const AActor* Victim, float Damage, const AActor* Instigator);
+
+	/** Stamps a death */
+	void Auth_ReportDeath(const FVector& Location);
+
+	/** Returns the threat to a team at a location, summed over the teams hostile to it */
+	float GetThreat(const FVector& Location, uint8 Team) const;
+
+	/** Returns the recent damage at a location */
+	float GetDamage(const FVector& Location) const;
+
+	/** Returns the recent noise at a location */
+	float GetNoise(const FVector& Location) const;
+
+	/**
+	 * @brief Scans the cells around an origin for the best answer to a tactical question
+	 * @param Query question to answer
+	 * @param Origin center of the search
+	 * @param Radius max distance from the origin
+	 * @param Querier location of the NPC asking, used to pick flanks
+	 * @param Team team of the NPC asking
+	 * @param OutLocation center of the best cell
+	 * @return false if no cell qualifies
+	 */
+	bool FindLocation(EShooterInfluenceQuery Query, const FVector& Origin, float Radius, const FVector& Querier, uint8 Team, FVector& OutLocation) const;
+
+protected:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+
+	/** Multiplies a layer by a decay factor and flushes tiny values to zero */
+	void DecayLayer(int32 Layer, float Factor);
+
+	/** Adds a value to a layer with a linear falloff over a radius */
+	void Stamp(int32 Layer, const FVector& Location, float Radius, float Amount);
+
+	/** Returns a layer's value at a cell */
+	float GetValue(int32 Layer, int32 Cell) const { return Layers[Layer * LayerStride + Cell]; }
+
+	/** Returns the cell for a location, or INDEX_NONE if it's outside the grid */
+	int32 GetCell(const FVector& Location) const;
+
+	/** Returns the hostile threat to a team at a cell */
+	float GetThreatAtCell(int32 Cell, uint8 Team) const;
+
+	/** Returns true if the grid has been laid out */
+	bool IsInitialized() const { return LayerStride > 0; }
+};
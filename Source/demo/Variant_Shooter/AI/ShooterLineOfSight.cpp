@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/AI/ShooterLineOfSight.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+bool FShooterLineOfSight::HasLineOfSight(const UWorld* World, const FVector& Start, const AActor* Target, int32 NumberOfVerticalChecks, const AActor* IgnoredActor)
+{
+	if (!World || !IsValid(Target))
+	{
+		return false;
+	}
+
+	TArray<FVector, TInlineAllocator<8>> Points;
+	GetSamplePoints(Target, NumberOfVerticalChecks, Points);
+
+	// ignore the observer and target. We want to ensure there's an unobstructed trace not counting them
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ShooterLineOfSight), false);
+	QueryParams.AddIgnoredActor(Target);
+
+	if (IgnoredActor)
+	{
+		QueryParams.AddIgnoredActor(IgnoredActor);
+	}
+
+	FHitResult OutHit;
+
+	for (const FVector& End : Points)
+	{
+		// we only need one unobstructed trace, so terminate early
+		if (!World->LineTraceSingleByChannel(OutHit, Start, End, ECC_Visibility, QueryParams))
+		{
+			return true;
+		}
+	}
+
+	// no line of sight found
+	return false;
+}
+
+void FShooterLineOfSight::GetSamplePoints(const AActor* Target, int32 NumberOfVerticalChecks, TArray<FVector, TInlineAllocator<8>>& OutPoints)
+{
+	// get the target's bounding box
+	FVector CenterOfMass, Extent;
+	Target->GetActorBounds(true, CenterOfMass, Extent, false);
+
+	GetSamplePoints(CenterOfMass, Extent, NumberOfVerticalChecks, OutPoints);
+}
+
+void FShooterLineOfSight::GetSamplePoints(const FVector& CenterOfMass, const FVector& Extent, int32 NumberOfVerticalChecks, TArray<FVector, TInlineAllocator<8>>& OutPoints)
+{
+	OutPoints.Reset();
+
+	if (NumberOfVerticalChecks <= 0)
+	{
+		return;
+	}
+
+	// a single check goes straight for the center
+	if (NumberOfVerticalChecks == 1)
+	{
+		OutPoints.Add(CenterOfMass);
+		return;
+	}
+
+	// divide the vertical extent by the number of line of sight checks we'll do
+	const float ExtentZOffset = Extent.Z * 2.0f / NumberOfVerticalChecks;
+
+	// the bottom sample is skipped, it's usually hidden by the floor
+	for (int32 i = 0; i < NumberOfVerticalChecks - 1; ++i)
+	{
+		OutPoints.Add(CenterOfMass + FVector(0.0f, 0.0f, Extent.Z - ExtentZOffset * i));
+	}
+}
@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UWorld;
+class AActor;
+
+/**
+ *  Shared line of sight checks used by the AI and by network visibility culling
+ */
+class DEMO_API FShooterLineOfSight
+{
+public:
+
+	/**
+	 * @brief Traces from a viewpoint to a number of points spread vertically over the target's bounds
+	 * @param World world to trace in
+	 * @param Start viewpoint to trace from
+	 * @param Target actor to check visibility for. It's always ignored by the traces
+	 * @param NumberOfVerticalChecks number of vertical samples over the target's bounds
+	 * @param IgnoredActor optional extra actor to ignore, usually the observer
+	 * @return true if at least one of the traces is unobstructed
+	 */
+	static bool HasLineOfSight(const UWorld* World, const FVector& Start, const AActor* Target, int32 NumberOfVerticalChecks, const AActor* IgnoredActor = nullptr);
+
+	/**
+	 * @brief Builds the vertically spread sample points used by the line of sight checks
+	 * @param Target actor to build the sample points for
+	 * @param NumberOfVerticalChecks number of vertical samples over the target's bounds
+	 * @param OutPoints sample points, top to bottom
+	 */
+	static void GetSamplePoints(const AActor* Target, int32 NumberOfVerticalChecks, TArray<FVector, TInlineAllocator<8>>& OutPoints);
+
+	/**
+	 * @brief Builds the sample points from already known bounds. A single check samples the bounds center
+	 * @param Center center of the target's bounds
+	 * @param Extent half size of the target's bounds
+	 * @param NumberOfVerticalChecks number of vertical samples over the bounds
+	 * @param OutPoints sample points, top to bottom
+	 */
+	static void GetSamplePoints(const FVector& Center, const FVector& Extent, int32 NumberOfVerticalChecks, TArray<FVector, TInlineAllocator<8>>& OutPoints);
+};
@@ -0,0 +1,241 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/AI/ShooterLineOfSightSubsystem.h"
+#include "ShooterLineOfSight.h"
+#include "ShooterVisibilityGrid.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+bool UShooterLineOfSightSubsystem::HasLineOfSight(AActor* Observer, const FVector& Start, AActor* Target, int32 NumberOfVerticalChecks)
+{
+	if (!IsValid(Target))
+	{
+		return false;
+	}
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	const FQueryKey Key { Observer, Target, NumberOfVerticalChecks };
+
+	if (FQueryEntry* Entry = Entries.Find(Key))
+	{
+		Entry->Start = Start;
+		Entry->LastRequestTime = Now;
+
+		// expired results are still served while an async refresh is on its way
+		if (Now - Entry->ResultTime > ValidityWindow && Entry->PendingTraces.Num() == 0)
+		{
+			Entry->bRefreshQueued = true;
+		}
+
+		return Entry->bVisible;
+	}
+
+	// cold miss. Mutually invisible cells don't need a trace, and aren't worth caching either
+	if (!IsPotentiallyVisible(Start, Target->GetActorLocation()))
+	{
+		return false;
+	}
+
+	// otherwise we can't answer without tracing right away
+	TArray<FVector, TInlineAllocator<8>> Points;
+	GetSamplePoints(Target, NumberOfVerticalChecks, Points);
+
+	const FCollisionQueryParams QueryParams = MakeQueryParams(Observer, Target);
+
+	bool bVisible = false;
+
+	for (const FVector& End : Points)
+	{
+		// we only need one unobstructed trace, so terminate early
+		if (!GetWorld()->LineTraceTestByChannel(Start, End, ECC_Visibility, QueryParams))
+		{
+			bVisible = true;
+			break;
+		}
+	}
+
+	FQueryEntry& NewEntry = Entries.Add(Key);
+	NewEntry.Observer = Observer;
+	NewEntry.Target = Target;
+	NewEntry.Start = Start;
+	NewEntry.ResultTime = Now;
+	NewEntry.LastRequestTime = Now;
+	NewEntry.bVisible = bVisible;
+
+	return bVisible;
+}
+
+bool UShooterLineOfSightSubsystem::IsPotentiallyVisible(const FVector& From, const FVector& To) const
+{
+	for (const TWeakObjectPtr<const AShooterVisibilityGrid>& Grid : VisibilityGrids)
+	{
+		if (Grid.IsValid() && !Grid->ArePotentiallyVisible(From, To))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void UShooterLineOfSightSubsystem::RegisterVisibilityGrid(const AShooterVisibilityGrid* Grid)
+{
+	VisibilityGrids.AddUnique(Grid);
+}
+
+void UShooterLineOfSightSubsystem::UnregisterVisibilityGrid(const AShooterVisibilityGrid* Grid)
+{
+	VisibilityGrids.Remove(Grid);
+}
+
+bool UShooterLineOfSightSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterLineOfSightSubsystem::Tick(float DeltaTime)
+{
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	int32 TraceBudget = MaxAsyncTracesPerFrame;
+
+	for (auto It = Entries.CreateIterator(); It; ++It)
+	{
+		FQueryEntry& Entry = It.Value();
+
+		// drop results for actors that are gone or that nobody asks about anymore
+		if (!Entry.Target.IsValid() || Now - Entry.LastRequestTime > EvictionTime)
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		// pick up the results of last frame's traces
+		if (Entry.PendingTraces.Num() > 0)
+		{
+			CollectPendingTraces(Entry, Now);
+			continue;
+		}
+
+		// refresh expired results within the frame's budget
+		if (Entry.bRefreshQueued && TraceBudget > 0)
+		{
+			TraceBudget -= StartAsyncTraces(Entry, It.Key().NumberOfVerticalChecks);
+		}
+	}
+
+	// drop bounds for actors that are gone
+	for (auto It = TargetBounds.CreateIterator(); It; ++It)
+	{
+		if (Now - It.Value().Time > EvictionTime || !It.Key().ResolveObjectPtr())
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+TStatId UShooterLineOfSightSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterLineOfSightSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterLineOfSightSubsystem::GetSamplePoints(AActor* Target, int32 NumberOfVerticalChecks, TArray<FVector, TInlineAllocator<8>>& OutPoints)
+{
+	const double Now = GetWorld()->GetTimeSeconds();
+	const FVector Location = Target->GetActorLocation();
+
+	FBoundsEntry& Bounds = TargetBounds.FindOrAdd(Target);
+
+	// recompute the bounds once in a while, they rarely change shape
+	if (Bounds.Time <= 0.0 || Now - Bounds.Time > BoundsValidity)
+	{
+		FVector Center;
+		Target->GetActorBounds(true, Center, Bounds.Extent, false);
+
+		Bounds.CenterOffset = Center - Location;
+		Bounds.Time = Now;
+	}
+
+	FShooterLineOfSight::GetSamplePoints(Location + Bounds.CenterOffset, Bounds.Extent, NumberOfVerticalChecks, OutPoints);
+}
+
+FCollisionQueryParams UShooterLineOfSightSubsystem::MakeQueryParams(const AActor* Observer, const AActor* Target)
+{
+	// ignore the observer and target. We want to ensure there's an unobstructed trace not counting them
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ShooterLineOfSightService), false);
+	QueryParams.AddIgnoredActor(Target);
+
+	if (Observer)
+	{
+		QueryParams.AddIgnoredActor(Observer);
+	}
+
+	return QueryParams;
+}
+
+bool UShooterLineOfSightSubsystem::CollectPendingTraces(FQueryEntry& Entry, double Now)
+{
+	bool bVisible = false;
+
+	for (const FTraceHandle& Handle : Entry.PendingTraces)
+	{
+		FTraceDatum Datum;
+
+		// the trace data only lives for a frame. If we missed it, queue another refresh
+		if (!GetWorld()->QueryTraceData(Handle, Datum))
+		{
+			Entry.PendingTraces.Reset();
+			Entry.bRefreshQueued = true;
+			return false;
+		}
+
+		// one unobstructed sample is enough
+		if (!Datum.OutHits.ContainsByPredicate([](const FHitResult& Hit) { return Hit.bBlockingHit; }))
+		{
+			bVisible = true;
+		}
+	}
+
+	Entry.PendingTraces.Reset();
+	Entry.bVisible = bVisible;
+	Entry.ResultTime = Now;
+
+	return true;
+}
+
+int32 UShooterLineOfSightSubsystem::StartAsyncTraces(FQueryEntry& Entry, int32 NumberOfVerticalChecks)
+{
+	AActor* Target = Entry.Target.Get();
+
+	// the baked grid can answer without tracing
+	if (!IsPotentiallyVisible(Entry.Start, Target->GetActorLocation()))
+	{
+		Entry.bVisible = false;
+		Entry.ResultTime = GetWorld()->GetTimeSeconds();
+		Entry.bRefreshQueued = false;
+
+		return 0;
+	}
+
+	TArray<FVector, TInlineAllocator<8>> Points;
+	GetSamplePoints(Target, NumberOfVerticalChecks, Points);
+
+	const FCollisionQueryParams QueryParams = MakeQueryParams(Entry.Observer.Get(), Target);
+
+	for (const FVector& End : Points)
+	{
+		Entry.PendingTraces.Add(GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Test, Entry.Start, End, ECC_Visibility, QueryParams));
+	}
+
+	// with no samples there's nothing to wait for, so the result stays as it is
+	if (Points.Num() == 0)
+	{
+		Entry.ResultTime = GetWorld()->GetTimeSeconds();
+	}
+
+	Entry.bRefreshQueued = false;
+
+	return Points.Num();
+}
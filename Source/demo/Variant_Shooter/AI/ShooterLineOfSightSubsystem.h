@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "WorldCollision.h"
+#include "ShooterLineOfSightSubsystem.generated.h"
+
+class AShooterVisibilityGrid;
+
+/**
+ *  Shared line of sight service for the AI
+ *  Caches results per observer, target and number of samples, so repeated checks within the validity window are free
+ *  Expired results are kept while a batch of async traces refreshes them. Only a cold miss traces synchronously
+ *  Target bounds are cached too, so sample points don't recompute the bounds on every query
+ *  Pairs in cells that a baked visibility grid marks as mutually invisible are rejected before tracing
+ */
+UCLASS(config=Game)
+class DEMO_API UShooterLineOfSightSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Identifies a cached line of sight result */
+	struct FQueryKey
+	{
+		TObjectKey<AActor> Observer;
+		TObjectKey<AActor> Target;
+		int32 NumberOfVerticalChecks = 0;
+
+		bool operator==(const FQueryKey& Other) const
+		{
+			return Observer == Other.Observer && Target == Other.Target && NumberOfVerticalChecks == Other.NumberOfVerticalChecks;
+		}
+
+		friend uint32 GetTypeHash(const FQueryKey& Key)
+		{
+			return HashCombine(HashCombine(GetTypeHash(Key.Observer), GetTypeHash(Key.Target)), ::GetTypeHash(Key.NumberOfVerticalChecks));
+		}
+	};
+
+	/** Cached line of sight result */
+	struct FQueryEntry
+	{
+		/** Actor looking */
+		TWeakObjectPtr<AActor> Observer;
+
+		/** Actor being looked at */
+		TWeakObjectPtr<AActor> Target;
+
+		/** Viewpoint of the last request, used for the next refresh */
+		FVector Start = FVector::ZeroVector;
+
+		/** Async traces in flight, one per sample point */
+		TArray<FTraceHandle, TInlineAllocator<8>> PendingTraces;
+
+		/** Time the result was computed */
+		double ResultTime = 0.0;
+
+		/** Last time anyone asked for this result */
+		double LastRequestTime = 0.0;
+
+		/** Last known result */
+		bool bVisible = false;
+
+		/** If true, the result expired and is waiting for an async refresh */
+		bool bRefreshQueued = false;
+	};
+
+	/** Cached bounds of a target, relative to its location */
+	struct FBoundsEntry
+	{
+		/** Bounds center offset from the actor location */
+		FVector CenterOffset = FVector::ZeroVector;
+
+		/** Bounds half size */
+		FVector Extent = FVector::ZeroVector;
+
+		/** Time the bounds were computed */
+		double Time = 0.0;
+	};
+
+	/** Time a line of sight result stays valid */
+	UPROPERTY(Config)
+	float ValidityWindow = 0.2f;
+
+	/** Results nobody asked for in this long are discarded */
+	UPROPERTY(Config)
+	float EvictionTime = 2.0f;
+
+	/** Time target bounds stay valid. Bounds follow the actor's location in between */
+	UPROPERTY(Config)
+	float BoundsValidity = 1.0f;
+
+	/** Max number of async traces to start per frame */
+	UPROPERTY(Config)
+	int32 MaxAsyncTracesPerFrame = 64;
+
+	/** Cached results */
+	TMap<FQueryKey, FQueryEntry> Entries;
+
+	/** Cached target bounds */
+	TMap<TObjectKey<AActor>, FBoundsEntry> TargetBounds;
+
+	/** Baked visibility grids in the level */
+	TArray<TWeakObjectPtr<const AShooterVisibilityGrid>> VisibilityGrids;
+
+public:
+
+	/**
+	 * @brief Checks whether the observer can see the target, using the cache where possible
+	 * @param Observer actor looking. It's ignored by the traces
+	 * @param Start viewpoint to trace from
+	 * @param Target actor to check visibility for. It's ignored by the traces
+	 * @param NumberOfVerticalChecks number of vertical samples over the target's bounds. One samples the bounds center
+	 * @return true if at least one sample point was unobstructed on the last refresh
+	 */
+	bool HasLineOfSight(AActor* Observer, const FVector& Start, AActor* Target, int32 NumberOfVerticalChecks);
+
+	/** Returns false if a baked visibility grid rules out any sightline between the two locations */
+	bool IsPotentiallyVisible(const FVector& From, const FVector& To) const;
+
+	/** Adds a baked visibility grid to check pairs against */
+	void RegisterVisibilityGrid(const AShooterVisibilityGrid* Grid);
+
+	/** Removes a baked visibility grid */
+	void UnregisterVisibilityGrid(const AShooterVisibilityGrid* Grid);
+
+protected:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+
+	/** Builds the sample points for a target from its cached bounds */
+	void GetSamplePoints(AActor* Target, int32 NumberOfVerticalChecks, TArray<FVector, TInlineAllocator<8>>& OutPoints);
+
+	/** Builds the trace params for an entry */
+	static FCollisionQueryParams MakeQueryParams(const AActor* Observer, const AActor* Target);
+
+	/** Collects finished async traces. Returns true if the entry's result was updated */
+	bool CollectPendingTraces(FQueryEntry& Entry, double Now);
+
+	/** Starts the async traces refreshing an entry. Returns the number of traces started */
+	int32 StartAsyncTraces(FQueryEntry& Entry, int32 NumberOfVerticalChecks);
+};
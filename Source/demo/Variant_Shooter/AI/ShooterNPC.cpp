@@ -6,6 +6,15 @@
 #include "demo.h"
 #include "DemoPlayerState.h"
 #include "ShooterWeapon.h"
+#include "ShooterNetRateComponent.h"
+#include "ShooterNetInterpolationComponent.h"
+#include "ShooterNetVisibilitySubsystem.h"
+#include "ShooterJoinReplicationSubsystem.h"
+#include "ShooterAILODSubsystem.h"
+#include "ShooterInfluenceMapSubsystem.h"
+#include "ShooterAIController.h"
+#include "ShooterNPCPoolSubsystem.h"
+#include "ShooterAimSubsystem.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "Camera/CameraComponent.h"
 #include "Kismet/KismetMathLibrary.h"
@@ -16,8 +25,38 @@
 #include "TimerManager.h"
 #include "net/UnrealNetwork.h"
 
-void AShooterNPC::OnRep_bIsDead()
+void AShooterNPC::OnRep_CombatState(const FCombatNetState& OldState)
 {
+	// the server keeps the full precision HP
+	if (!HasAuthority())
+	{
+		// initial replication may arrive before BeginPlay, so latch the starting HP here too
+		if (MaxHP <= 0.0f)
+		{
+			MaxHP = CurrentHP;
+		}
+
+		CurrentHP = CombatState.GetHealth(MaxHP);
+		bIsDead = CombatState.bIsDead;
+	}
+
+	// pooled NPCs come back to life when they're reused
+	if (!CombatState.bIsDead && OldState.bIsDead)
+	{
+		Local_ResetRagdoll();
+		NetInterpolation->Local_RestartInterpolation();
+		return;
+	}
+
+	// only react to the death transition
+	if (!CombatState.bIsDead || OldState.bIsDead)
+	{
+		return;
+	}
+
+	// physics takes over from the snapshots
+	NetInterpolation->Local_StopInterpolation();
+
 	GetCapsuleComponent()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 
 	GetCharacterMovement()->StopMovementImmediately();
@@ -31,8 +70,7 @@ void AShooterNPC::OnRep_bIsDead()
 void AShooterNPC::GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
-    DOREPLIFETIME(AShooterNPC, CurrentHP);
-	DOREPLIFETIME(AShooterNPC, bIsDead);
+	DOREPLIFETIME(AShooterNPC, CombatState);
 	DOREPLIFETIME(AShooterNPC, Weapon);
 }
 
@@ -40,8 +78,20 @@ void AShooterNPC::BeginPlay()
 {
 	Super::BeginPlay();
 
+	// the starting HP is the same on the server and clients, so it doubles as the max HP for the combat state
+	if (MaxHP <= 0.0f)
+	{
+		MaxHP = CurrentHP;
+	}
+
+	// remember how the mesh sits on the capsule so it can come back from ragdoll
+	MeshRelativeTransform = GetMesh()->GetRelativeTransform();
+	MeshCollisionProfile = GetMesh()->GetCollisionProfileName();
+
 	if (HasAuthority())
 	{
+		CombatState.SetHealth(CurrentHP, MaxHP);
+
 		FActorSpawnParameters SpawnParams;
 		SpawnParams.Owner = this;
 		SpawnParams.Instigator = this;
@@ -62,6 +112,68 @@ void AShooterNPC::EndPlay(const EEndPlayReason::Type EndPlayReason)
 AShooterNPC::AShooterNPC()
 {
 	bReplicates = true;
+
+	// create the net rate component
+	NetRate = CreateDefaultSubobject<UShooterNetRateComponent>(TEXT("Net Rate"));
+
+	// create the net interpolation component
+	NetInterpolation = CreateDefaultSubobject<UShooterNetInterpolationComponent>(TEXT("Net Interpolation"));
+
+	// distant NPCs nav walk, so keep them glued to the navmesh without sweeping the capsule
+	GetCharacterMovement()->bSweepWhileNavWalking = false;
+	GetCharacterMovement()->bProjectNavMeshWalking = true;
+}
+
+void AShooterNPC::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	NetInterpolation->Auth_CaptureSnapshot();
+}
+
+void AShooterNPC::OnMovementModeChanged(EMovementMode PrevMovementMode, uint8 PreviousCustomMode)
+{
+	Super::OnMovementModeChanged(PrevMovementMode, PreviousCustomMode);
+
+	// landing goes back to whichever ground mode we had before falling, which may not be what the tier wants anymore.
+	// Only fix it up on landing, so failing to find the navmesh while nav walking can still fall back to walking
+	if (!HasAuthority() || PrevMovementMode != MOVE_Falling)
+	{
+		return;
+	}
+
+	UCharacterMovementComponent* Movement = GetCharacterMovement();
+	const EMovementMode GroundMode = bNavWalkOnGround ? MOVE_NavWalking : MOVE_Walking;
+
+	if (Movement->IsMovingOnGround() && Movement->MovementMode != GroundMode)
+	{
+		Movement->SetMovementMode(GroundMode);
+	}
+}
+
+void AShooterNPC::Auth_SetNavWalkOnGround(bool bInNavWalkOnGround)
+{
+	bNavWalkOnGround = bInNavWalkOnGround;
+
+	// falling and other modes finish on their own, and we catch up when landing
+	UCharacterMovementComponent* Movement = GetCharacterMovement();
+
+	if (Movement->IsMovingOnGround())
+	{
+		Movement->SetMovementMode(bNavWalkOnGround ? MOVE_NavWalking : MOVE_Walking);
+	}
+}
+
+FRotator AShooterNPC::GetBaseAimRotation() const
+{
+	FRotator AimRotation;
+
+	if (GetLocalRole() == ROLE_SimulatedProxy && NetInterpolation->GetInterpolatedAimRotation(AimRotation))
+	{
+		return AimRotation;
+	}
+
+	return Super::GetBaseAimRotation();
 }
 
 float AShooterNPC::TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
@@ -81,6 +193,22 @@ float AShooterNPC::Auth_TakeDamage(float Damage, struct FDamageEvent const& Dama
 	if (!HasAuthority())
 		return 0.0f;
 	CurrentHP -= Damage;
+	CombatState.SetHealth(CurrentHP, MaxHP);
+
+	// being shot at is combat, so replicate at the active rate
+	NetRate->Auth_NotifyActivity();
+
+	// and think at full rate
+	if (UShooterAILODSubsystem* AILOD = GetWorld()->GetSubsystem<UShooterAILODSubsystem>())
+	{
+		AILOD->Auth_NotifyCombat(Cast<AShooterAIController>(GetController()));
+	}
+
+	// mark the hit on the tactical map
+	if (UShooterInfluenceMapSubsystem* InfluenceMap = GetWorld()->GetSubsystem<UShooterInfluenceMapSubsystem>())
+	{
+		InfluenceMap->Auth_ReportDamage(this, Damage, EventInstigator ? EventInstigator->GetPawn() : nullptr);
+	}
 
 	if (CurrentHP <= 0.0f)
 	{
@@ -89,6 +217,118 @@ float AShooterNPC::Auth_TakeDamage(float Damage, struct FDamageEvent const& Dama
 	return Damage;
 }
 
+void AShooterNPC::InitFromCrowd(float InCurrentHP, float InMaxHP, uint8 InTeamByte, TSubclassOf<AShooterWeapon> InWeaponClass)
+{
+	// BeginPlay keeps a max HP that's already set
+	CurrentHP = InCurrentHP;
+	MaxHP = InMaxHP;
+	TeamByte = InTeamByte;
+
+	if (InWeaponClass)
+	{
+		WeaponClass = InWeaponClass;
+	}
+}
+
+void AShooterNPC::Auth_EnterPool()
+{
+	if (!HasAuthority())
+	{
+		return;
+	}
+
+	GetWorld()->GetTimerManager().ClearTimer(DeathTimer);
+
+	// whoever takes this NPC next binds its own listeners
+	OnPawnDeath.Clear();
+
+	// hidden actors without collision aren't relevant, so parked NPCs also stop replicating
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+	SetActorTickEnabled(false);
+
+	Local_ResetRagdoll();
+
+	UCharacterMovementComponent* Movement = GetCharacterMovement();
+	Movement->StopMovementImmediately();
+	Movement->DisableMovement();
+	Movement->SetComponentTickEnabled(false);
+
+	if (Weapon)
+	{
+		Weapon->Auth_StopFiring();
+		Weapon->SetActorHiddenInGame(true);
+	}
+}
+
+void AShooterNPC::Auth_LeavePool(const FTransform& Transform)
+{
+	if (!HasAuthority())
+	{
+		return;
+	}
+
+	const FCombatNetState OldState = CombatState;
+
+	// start over at full health
+	CurrentHP = MaxHP;
+	bIsDead = false;
+	bIsShooting = false;
+	CurrentAimTarget = nullptr;
+
+	CombatState.bIsDead = false;
+	CombatState.bIsFiring = false;
+	CombatState.SetHealth(CurrentHP, MaxHP);
+
+	SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+	SetActorTickEnabled(true);
+
+	UCharacterMovementComponent* Movement = GetCharacterMovement();
+	Movement->SetComponentTickEnabled(true);
+	Movement->SetMovementMode(MOVE_Walking);
+
+	if (Weapon)
+	{
+		Weapon->Auth_ResetForReuse();
+		Weapon->SetActorHiddenInGame(false);
+	}
+
+	// clients should see the spawn right away
+	NetRate->Auth_NotifyActivity();
+
+	SV_REPCALL_PREV(CombatState, OldState);
+}
+
+bool AShooterNPC::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	if (!Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation))
+	{
+		return false;
+	}
+
+	// late joiners receive nearby NPCs before distant ones
+	if (UShooterJoinReplicationSubsystem* JoinReplication = GetWorld()->GetSubsystem<UShooterJoinReplicationSubsystem>())
+	{
+		const EShooterJoinPriority Priority = JoinReplication->GetPriorityByDistance(this, SrcLocation, EShooterJoinPriority::Combat, EShooterJoinPriority::World);
+
+		if (!JoinReplication->IsUnlockedFor(RealViewer, Priority))
+		{
+			return false;
+		}
+	}
+
+	// enemies behind walls are dropped from the connection
+	if (UShooterNetVisibilitySubsystem* Visibility = GetWorld()->GetSubsystem<UShooterNetVisibilitySubsystem>())
+	{
+		return Visibility->IsVisibleTo(this, RealViewer, ViewTarget, SrcLocation);
+	}
+
+	return true;
+}
+
 void AShooterNPC::AttachWeaponMeshes(AShooterWeapon* WeaponToAttach)
 {
 	const FAttachmentTransformRules AttachmentRule(EAttachmentRule::SnapToTarget, false);
@@ -113,11 +353,22 @@ void AShooterNPC::AddWeaponRecoil(float Recoil)
 
 void AShooterNPC::UpdateWeaponHUD(int32 CurrentAmmo, int32 MagazineSize)
 {
-	// unused
+	// unused. NPC ammo isn't shown anywhere, so it's left out of the combat state to keep it small
 }
 
 FVector AShooterNPC::GetWeaponTargetLocation()
 {
+	// use the batched solution if it's ready
+	if (UShooterAimSubsystem* Aim = GetWorld()->GetSubsystem<UShooterAimSubsystem>())
+	{
+		FVector Solution;
+
+		if (Aim->ConsumeAimLocation(this, Solution))
+		{
+			return Solution;
+		}
+	}
+
 	// start aiming from the camera location
 	const FVector AimSource = GetFirstPersonCameraComponent()->GetComponentLocation();
 
@@ -159,6 +410,18 @@ FVector AShooterNPC::GetWeaponTargetLocation()
 	return OutHit.bBlockingHit ? OutHit.ImpactPoint : OutHit.TraceEnd;
 }
 
+void AShooterNPC::BuildAimRequest(FShooterAimRequest& OutRequest) const
+{
+	OutRequest.Source = GetFirstPersonCameraComponent()->GetComponentLocation();
+	OutRequest.Forward = GetFirstPersonCameraComponent()->GetForwardVector();
+	OutRequest.bHasTarget = CurrentAimTarget != nullptr;
+	OutRequest.Target = CurrentAimTarget ? CurrentAimTarget->GetActorLocation() : FVector::ZeroVector;
+	OutRequest.VarianceHalfAngle = AimVarianceHalfAngle;
+	OutRequest.MinOffsetZ = MinAimOffsetZ;
+	OutRequest.MaxOffsetZ = MaxAimOffsetZ;
+	OutRequest.Range = AimRange;
+}
+
 void AShooterNPC::AddWeaponClass(const TSubclassOf<AShooterWeapon>& InWeaponClass)
 {
 	// unused
@@ -184,11 +447,6 @@ void AShooterNPC::OnSemiWeaponRefire()
 	}
 }
 
-void AShooterNPC::OnRep_CurrentHP()
-{
-	
-}
-
 void AShooterNPC::OnRep_Weapon()
 {
 	
@@ -201,9 +459,21 @@ void AShooterNPC::Auth_Die(AController* KillerController)
 		return;
 	}
 
+	const FCombatNetState OldState = CombatState;
+
 	bIsDead = true;
+	CombatState.bIsDead = true;
+	CombatState.bIsFiring = false;
+
+	// deaths make the area dangerous for a while
+	if (UShooterInfluenceMapSubsystem* InfluenceMap = GetWorld()->GetSubsystem<UShooterInfluenceMapSubsystem>())
+	{
+		InfluenceMap->Auth_ReportDeath(GetActorLocation());
+	}
+
+	// schedule the deferred destruction
+	GetWorld()->GetTimerManager().SetTimer(DeathTimer, this, &AShooterNPC::DeferredDestruction, DeferredDestructionTime, false);
 
-	
 	if (KillerController && KillerController != GetController())
 	{
 		if (ADemoPlayerState* KillerPS = Cast<ADemoPlayerState>(KillerController->PlayerState))
@@ -213,14 +483,42 @@ void AShooterNPC::Auth_Die(AController* KillerController)
 		}
 	}	
 
-	SV_REPCALL(bIsDead);
+	SV_REPCALL_PREV(CombatState, OldState);
+
+	// let the controller and anyone else listening know
+	OnPawnDeath.Broadcast();
 }
 
 void AShooterNPC::DeferredDestruction()
 {
+	// pooled NPCs are parked for the next spawn instead
+	if (bPooled)
+	{
+		if (UShooterNPCPoolSubsystem* Pool = GetWorld()->GetSubsystem<UShooterNPCPoolSubsystem>())
+		{
+			Pool->Auth_ReleaseNPC(this);
+			return;
+		}
+	}
+
 	Destroy();
 }
 
+void AShooterNPC::Local_ResetRagdoll()
+{
+	USkeletalMeshComponent* MeshComponent = GetMesh();
+
+	MeshComponent->SetSimulatePhysics(false);
+	MeshComponent->SetPhysicsBlendWeight(0.0f);
+	MeshComponent->SetCollisionProfileName(MeshCollisionProfile);
+
+	// physics may have detached the mesh, so snap it back onto the capsule
+	MeshComponent->AttachToComponent(GetCapsuleComponent(), FAttachmentTransformRules::KeepRelativeTransform);
+	MeshComponent->SetRelativeTransform(MeshRelativeTransform);
+
+	GetCapsuleComponent()->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+}
+
 void AShooterNPC::StartShooting(AActor* ActorToShoot)
 {
 	// save the aim target
@@ -231,7 +529,16 @@ void AShooterNPC::StartShooting(AActor* ActorToShoot)
 
 	// signal the weapon
 	if (HasAuthority())
+	{
+		CombatState.bIsFiring = true;
 		Weapon->Auth_StartFiring();
+
+		// solve the following shots in the batch
+		if (UShooterAimSubsystem* Aim = GetWorld()->GetSubsystem<UShooterAimSubsystem>())
+		{
+			Aim->Auth_AddShooter(this);
+		}
+	}
 }
 
 void AShooterNPC::StopShooting()
@@ -241,5 +548,13 @@ void AShooterNPC::StopShooting()
 
 	// signal the weapon
 	if (HasAuthority())
+	{
+		CombatState.bIsFiring = false;
 		Weapon->Auth_StopFiring();
+
+		if (UShooterAimSubsystem* Aim = GetWorld()->GetSubsystem<UShooterAimSubsystem>())
+		{
+			Aim->Auth_RemoveShooter(this);
+		}
+	}
 }
@@ -5,11 +5,16 @@
 #include "CoreMinimal.h"
 #include "demoCharacter.h"
 #include "ShooterWeaponHolder.h"
+#include "GenericTeamAgentInterface.h"
+#include "ShooterCombatNetState.h"
 #include "ShooterNPC.generated.h"
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FPawnDeathDelegate);
 
 class AShooterWeapon;
+class UShooterNetRateComponent;
+struct FShooterAimRequest;
+class UShooterNetInterpolationComponent;
 
 /**
  *  A simple AI-controlled shooter game NPC
@@ -17,18 +22,33 @@ class AShooterWeapon;
  *  Holds and manages a weapon
  */
 UCLASS(abstract)
-class DEMO_API AShooterNPC : public AdemoCharacter, public IShooterWeaponHolder
+class DEMO_API AShooterNPC : public AdemoCharacter, public IShooterWeaponHolder, public IGenericTeamAgentInterface
 {
 	GENERATED_BODY()
 
+	/** Adapts the net update frequency to combat activity */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
+	UShooterNetRateComponent* NetRate;
+
+	/** Replicates movement and aim as interpolated snapshots, so the NPC can run at low net update rates */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
+	UShooterNetInterpolationComponent* NetInterpolation;
+
 public:
 
-	/** Current HP for this character. It dies if it reaches zero through damage */
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Damage",ReplicatedUsing=OnRep_CurrentHP)
+	/** Current HP for this character. It dies if it reaches zero through damage. Clients derive it from the combat state */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Damage")
 	float CurrentHP = 100.0f;
 
 protected:
 
+	/** HP this character started with. Used to quantize the replicated health */
+	float MaxHP = 0.0f;
+
+	/** Packed health and flags replicated to clients */
+	UPROPERTY(ReplicatedUsing=OnRep_CombatState)
+	FCombatNetState CombatState;
+
 	/** Name of the collision profile to use during ragdoll death */
 	UPROPERTY(EditAnywhere, Category="Damage")
 	FName RagdollCollisionProfile = FName("Ragdoll");
@@ -79,13 +99,24 @@ protected:
 	/** If true, this character is currently shooting its weapon */
 	bool bIsShooting = false;
 
-	/** If true, this character has already died */
-	UPROPERTY(ReplicatedUsing=OnRep_bIsDead)
+	/** If true, this character has already died. Mirrored from the combat state on clients */
 	bool bIsDead = false;
 
 	/** Deferred destruction on death timer */
 	FTimerHandle DeathTimer;
 
+	/** If true, this NPC came from the NPC pool and is parked there instead of destroyed after death */
+	bool bPooled = false;
+
+	/** Mesh transform relative to the capsule, restored after ragdoll */
+	FTransform MeshRelativeTransform;
+
+	/** Mesh collision profile, restored after ragdoll */
+	FName MeshCollisionProfile;
+
+	/** If true, the AI LOD tier wants this NPC nav walking whenever it's on the ground */
+	bool bNavWalkOnGround = false;
+
 public:
 
 	/** Delegate called when this NPC dies */
@@ -93,7 +124,7 @@ public:
 
 protected:
 	UFUNCTION()
-	void OnRep_bIsDead();
+	void OnRep_CombatState(const FCombatNetState& OldState);
 
 	virtual void GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const override;
 	
@@ -103,12 +134,62 @@ protected:
 	/** Gameplay cleanup */
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
+	/** Captures the movement snapshot right before it's replicated */
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
+	/** Lands in the ground movement mode picked by the AI LOD tier */
+	virtual void OnMovementModeChanged(EMovementMode PrevMovementMode, uint8 PreviousCustomMode = 0) override;
+
 public:
 
 	AShooterNPC();
 	/** Handle incoming damage */
 	virtual float TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser) override;
 	float Auth_TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser);
+
+	/** Returns the team byte for this character */
+	uint8 GetTeamByte() const { return TeamByte; }
+
+	//~Begin IGenericTeamAgentInterface interface
+
+	/** Returns the team ID built from the team byte */
+	virtual FGenericTeamId GetGenericTeamId() const override { return FGenericTeamId(TeamByte); }
+
+	//~End IGenericTeamAgentInterface interface
+
+	/** Returns the HP this character started with */
+	float GetMaxHP() const { return MaxHP; }
+
+	/** Returns the type of weapon this character spawns with */
+	TSubclassOf<AShooterWeapon> GetWeaponClass() const { return WeaponClass; }
+
+	/** Returns true if this character has died */
+	bool IsDead() const { return bIsDead; }
+
+	/** Carries over the state of a crowd entity being promoted to this actor. Must be called before BeginPlay */
+	void InitFromCrowd(float InCurrentHP, float InMaxHP, uint8 InTeamByte, TSubclassOf<AShooterWeapon> InWeaponClass);
+
+	/** Marks this NPC as owned by the NPC pool */
+	void SetPooled(bool bInPooled) { bPooled = bInPooled; }
+
+	/** Returns true if this NPC is owned by the NPC pool */
+	bool IsPooled() const { return bPooled; }
+
+	/** Hides and freezes this NPC while it's parked in the pool */
+	void Auth_EnterPool();
+
+	/** Brings this NPC back from the pool at full health at the given transform */
+	void Auth_LeavePool(const FTransform& Transform);
+
+	/** Switches between nav walking and full walking. Applied right away on the ground, otherwise on landing */
+	void Auth_SetNavWalkOnGround(bool bInNavWalkOnGround);
+
+	/** Culls this NPC for enemy connections that can't see it */
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
+	/** Returns the interpolated aim on simulated proxies */
+	virtual FRotator GetBaseAimRotation() const override;
+
 public:
 
 	//~Begin IShooterWeaponHolder interface
@@ -125,7 +206,7 @@ public:
 	/** Updates the weapon's HUD with the current ammo count */
 	virtual void UpdateWeaponHUD(int32 CurrentAmmo, int32 MagazineSize) override;
 
-	/** Calculates and returns the aim location for the weapon */
+	/** Calculates and returns the aim location for the weapon. Uses the batched aim solution when there is one */
 	virtual FVector GetWeaponTargetLocation() override;
 
 	/** Gives a weapon of this class to the owner */
@@ -143,8 +224,6 @@ public:
 	//~End IShooterWeaponHolder interface
 
 protected:
-	UFUNCTION()
-	void OnRep_CurrentHP();
 	UFUNCTION()
 	void OnRep_Weapon();
 
@@ -155,6 +234,9 @@ protected:
 	/** Called after death to destroy the actor */
 	void DeferredDestruction();
 
+	/** Takes the mesh out of ragdoll and puts it back on the capsule */
+	void Local_ResetRagdoll();
+
 public:
 
 	/** Signals this character to start shooting at the passed actor */
@@ -162,4 +244,10 @@ public:
 
 	/** Signals this character to stop shooting */
 	void StopShooting();
+
+	/** Returns the actor currently being aimed at */
+	AActor* GetAimTarget() const { return CurrentAimTarget; }
+
+	/** Fills in the aim parameters for the next shot, for the batched aim solver */
+	void BuildAimRequest(FShooterAimRequest& OutRequest) const;
 };
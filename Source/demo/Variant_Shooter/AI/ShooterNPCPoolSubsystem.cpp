@@ -0,0 +1,210 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/AI/ShooterNPCPoolSubsystem.h"
+#include "demo.h"
+#include "ShooterNPC.h"
+#include "ShooterAIController.h"
+#include "Engine/World.h"
+#include "HAL/PlatformTime.h"
+
+void UShooterNPCPoolSubsystem::Auth_QueueSpawn(TSubclassOf<AShooterNPC> NPCClass, const FTransform& Transform, FShooterNPCSpawnedDelegate OnSpawned)
+{
+	if (!NPCClass)
+	{
+		OnSpawned.ExecuteIfBound(nullptr);
+		return;
+	}
+
+	FSpawnRequest& Request = SpawnQueue.AddDefaulted_GetRef();
+	Request.NPCClass = NPCClass;
+	Request.Transform = Transform;
+	Request.OnSpawned = MoveTemp(OnSpawned);
+}
+
+void UShooterNPCPoolSubsystem::Auth_Prewarm(TSubclassOf<AShooterNPC> NPCClass, const FTransform& Transform, int32 Count)
+{
+	if (!NPCClass)
+	{
+		return;
+	}
+
+	for (int32 i = 0; i < Count; ++i)
+	{
+		FSpawnRequest& Request = SpawnQueue.AddDefaulted_GetRef();
+		Request.NPCClass = NPCClass;
+		Request.Transform = Transform;
+		Request.bPrewarm = true;
+	}
+}
+
+void UShooterNPCPoolSubsystem::Auth_ReleaseNPC(AShooterNPC* NPC)
+{
+	if (!IsValid(NPC))
+	{
+		return;
+	}
+
+	TArray<TWeakObjectPtr<AShooterNPC>>& Parked = ParkedNPCs.FindOrAdd(TObjectKey<UClass>(NPC->GetClass()));
+
+	// the pool is full, so let this one go
+	if (Parked.Num() >= MaxParkedPerClass)
+	{
+		NPC->Destroy();
+		return;
+	}
+
+	NPC->Auth_EnterPool();
+	Parked.Add(NPC);
+}
+
+void UShooterNPCPoolSubsystem::Auth_ReleaseController(AShooterAIController* Controller)
+{
+	if (!IsValid(Controller))
+	{
+		return;
+	}
+
+	TArray<TWeakObjectPtr<AShooterAIController>>& Parked = ParkedControllers.FindOrAdd(TObjectKey<UClass>(Controller->GetClass()));
+
+	if (Parked.Num() >= MaxParkedPerClass)
+	{
+		Controller->Destroy();
+		return;
+	}
+
+	Controller->Auth_EnterPool();
+	Parked.Add(Controller);
+}
+
+bool UShooterNPCPoolSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterNPCPoolSubsystem::Tick(float DeltaTime)
+{
+	if (SpawnQueue.Num() == 0)
+	{
+		return;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double Budget = SpawnBudgetMs * 0.001;
+
+	int32 NumProcessed = 0;
+
+	while (NumProcessed < SpawnQueue.Num() && NumProcessed < MaxSpawnsPerFrame)
+	{
+		// always make progress, but leave the rest for later frames once the budget is spent
+		if (NumProcessed > 0 && FPlatformTime::Seconds() - StartTime > Budget)
+		{
+			break;
+		}
+
+		// callbacks may queue more spawns, so don't hold on to the queue entry
+		const FSpawnRequest Request = MoveTemp(SpawnQueue[NumProcessed]);
+		++NumProcessed;
+
+		AShooterNPC* NPC = ProcessSpawn(Request);
+
+		Request.OnSpawned.ExecuteIfBound(NPC);
+	}
+
+	SpawnQueue.RemoveAt(0, NumProcessed, EAllowShrinking::No);
+}
+
+TStatId UShooterNPCPoolSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterNPCPoolSubsystem, STATGROUP_Tickables);
+}
+
+AShooterNPC* UShooterNPCPoolSubsystem::ProcessSpawn(const FSpawnRequest& Request)
+{
+	// prewarmed NPCs and controllers go straight into the pool
+	if (Request.bPrewarm)
+	{
+		AShooterNPC* NPC = SpawnNPC(Request.NPCClass, Request.Transform);
+
+		if (NPC)
+		{
+			Auth_ReleaseController(SpawnController(NPC->AIControllerClass, Request.Transform));
+			Auth_ReleaseNPC(NPC);
+		}
+
+		return NPC;
+	}
+
+	AShooterNPC* NPC = PopParked(ParkedNPCs.Find(TObjectKey<UClass>(Request.NPCClass.Get())));
+
+	if (NPC)
+	{
+		NPC->Auth_LeavePool(Request.Transform);
+
+	} else {
+
+		NPC = SpawnNPC(Request.NPCClass, Request.Transform);
+
+	}
+
+	if (!NPC)
+	{
+		return nullptr;
+	}
+
+	AShooterAIController* Controller = PopParked(ParkedControllers.Find(TObjectKey<UClass>(NPC->AIControllerClass.Get())));
+	const bool bReused = Controller != nullptr;
+
+	if (!Controller)
+	{
+		Controller = SpawnController(NPC->AIControllerClass, Request.Transform);
+	}
+
+	if (!Controller)
+	{
+		UE_LOG(Logdemo, Warning, TEXT("NPC pool: %s has no shooter AI controller class"), *GetNameSafe(Request.NPCClass));
+		return NPC;
+	}
+
+	Controller->Possess(NPC);
+
+	// parked controllers start over with a fresh StateTree and no memories
+	if (bReused)
+	{
+		Controller->Auth_LeavePool();
+	}
+
+	return NPC;
+}
+
+AShooterNPC* UShooterNPCPoolSubsystem::SpawnNPC(TSubclassOf<AShooterNPC> NPCClass, const FTransform& Transform)
+{
+	AShooterNPC* NPC = GetWorld()->SpawnActorDeferred<AShooterNPC>(NPCClass, Transform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn);
+
+	if (!NPC)
+	{
+		return nullptr;
+	}
+
+	// the pool hands out the controllers
+	NPC->AutoPossessAI = EAutoPossessAI::Disabled;
+	NPC->SetPooled(true);
+
+	NPC->FinishSpawning(Transform);
+
+	return NPC;
+}
+
+AShooterAIController* UShooterNPCPoolSubsystem::SpawnController(TSubclassOf<AController> ControllerClass, const FTransform& Transform)
+{
+	if (!ControllerClass || !ControllerClass->IsChildOf<AShooterAIController>())
+	{
+		return nullptr;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+
+	return GetWorld()->SpawnActor<AShooterAIController>(ControllerClass, Transform.GetLocation(), Transform.Rotator(), SpawnParams);
+}
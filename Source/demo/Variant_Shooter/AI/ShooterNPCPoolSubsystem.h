@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "ShooterNPCPoolSubsystem.generated.h"
+
+class AShooterNPC;
+class AShooterAIController;
+
+/** Called when a queued NPC spawn completes. The NPC is null if it couldn't be spawned */
+DECLARE_DELEGATE_OneParam(FShooterNPCSpawnedDelegate, AShooterNPC*);
+
+/**
+ *  Server-side pool of NPC pawns and AI controllers
+ *  Pooled NPCs are parked instead of destroyed once their death time runs out, and their controllers are parked
+ *  as soon as they die. Later spawns of the same classes reuse them. Pooled NPCs keep their weapon, so weapons are recycled with them
+ *  Spawns are queued and processed under a per-frame count and time budget
+ */
+UCLASS(config=Game)
+class DEMO_API UShooterNPCPoolSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** A queued spawn */
+	struct FSpawnRequest
+	{
+		/** NPC class to spawn */
+		TSubclassOf<AShooterNPC> NPCClass;
+
+		/** Spawn transform */
+		FTransform Transform;
+
+		/** Completion callback */
+		FShooterNPCSpawnedDelegate OnSpawned;
+
+		/** If true, the NPC and its controller are parked right away to fill the pool */
+		bool bPrewarm = false;
+	};
+
+	/** Max number of spawns processed per frame */
+	UPROPERTY(Config)
+	int32 MaxSpawnsPerFrame = 2;
+
+	/** Time budget for spawns per frame, in milliseconds. At least one spawn always goes through */
+	UPROPERTY(Config)
+	float SpawnBudgetMs = 1.0f;
+
+	/** Max number of parked NPCs per class. Extra NPCs are destroyed when released */
+	UPROPERTY(Config)
+	int32 MaxParkedPerClass = 32;
+
+	/** Spawns waiting for their frame, oldest first */
+	TArray<FSpawnRequest> SpawnQueue;
+
+	/** Parked NPCs by class */
+	TMap<TObjectKey<UClass>, TArray<TWeakObjectPtr<AShooterNPC>>> ParkedNPCs;
+
+	/** Parked controllers by class */
+	TMap<TObjectKey<UClass>, TArray<TWeakObjectPtr<AShooterAIController>>> ParkedControllers;
+
+public:
+
+	/**
+	 * @brief Queues an NPC spawn, reusing a parked NPC and controller when possible
+	 * @param NPCClass class of NPC to spawn
+	 * @param Transform spawn transform
+	 * @param OnSpawned called once the NPC is possessed and running
+	 */
+	void Auth_QueueSpawn(TSubclassOf<AShooterNPC> NPCClass, const FTransform& Transform, FShooterNPCSpawnedDelegate OnSpawned);
+
+	/** Queues spawns that go straight to the pool, so a later wave doesn't pay for them */
+	void Auth_Prewarm(TSubclassOf<AShooterNPC> NPCClass, const FTransform& Transform, int32 Count);
+
+	/** Parks a dead pooled NPC for reuse */
+	void Auth_ReleaseNPC(AShooterNPC* NPC);
+
+	/** Parks an unpossessed controller for reuse */
+	void Auth_ReleaseController(AShooterAIController* Controller);
+
+	/** Returns the number of spawns waiting in the queue */
+	int32 GetNumQueuedSpawns() const { return SpawnQueue.Num(); }
+
+protected:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+
+	/** Runs a queued spawn. Returns the NPC, or null if it couldn't be spawned */
+	AShooterNPC* ProcessSpawn(const FSpawnRequest& Request);
+
+	/** Spawns a new pooled NPC */
+	AShooterNPC* SpawnNPC(TSubclassOf<AShooterNPC> NPCClass, const FTransform& Transform);
+
+	/** Spawns a new controller. Returns null unless the class is a shooter AI controller */
+	AShooterAIController* SpawnController(TSubclassOf<AController> ControllerClass, const FTransform& Transform);
+
+	/** Pops the last valid entry of a parked list */
+	template<typename T>
+	static T* PopParked(TArray<TWeakObjectPtr<T>>* Parked)
+	{
+		while (Parked && Parked->Num() > 0)
+		{
+			if (T* Actor = Parked->Pop(EAllowShrinking::No).Get())
+			{
+				return Actor;
+			}
+		}
+
+		return nullptr;
+	}
+};
@@ -0,0 +1,147 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/AI/ShooterNoiseSubsystem.h"
+#include "ShooterAILODSubsystem.h"
+#include "ShooterAISense_Hearing.h"
+#include "Perception/AISense_Hearing.h"
+#include "GameFramework/Pawn.h"
+#include "Engine/World.h"
+
+void UShooterNoiseSubsystem::Auth_ReportNoise(const FVector& Location, float Loudness, APawn* Instigator, float MaxRange, FName Tag)
+{
+	// only the server's AI listens
+	if (GetWorld()->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	FNoiseKey Key;
+	Key.Instigator = Instigator;
+	Key.Cell = FIntVector(FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize), FMath::FloorToInt32(Location.Z / CellSize));
+	Key.Tag = Tag;
+
+	FPendingNoise* Noise = PendingNoises.Find(Key);
+
+	if (!Noise)
+	{
+		Noise = &PendingNoises.Add(Key);
+		Noise->Instigator = Instigator;
+		Noise->MaxRange = MaxRange;
+		Noise->FirstTime = GetWorld()->GetTimeSeconds();
+
+	} else if (Noise->MaxRange > 0.0f && MaxRange > 0.0f) {
+
+		Noise->MaxRange = FMath::Max(Noise->MaxRange, MaxRange);
+
+	} else {
+
+		// an unlimited range wins over any limit
+		Noise->MaxRange = 0.0f;
+
+	}
+
+	// louder noises pull the merged location towards them
+	const float Weight = FMath::Max(Loudness, UE_KINDA_SMALL_NUMBER);
+
+	Noise->WeightedLocation += Location * Weight;
+	Noise->LoudnessSum += Weight;
+	Noise->LoudnessSquaredSum += FMath::Square(Loudness);
+	Noise->MaxLoudness = FMath::Max(Noise->MaxLoudness, Loudness);
+}
+
+void UShooterNoiseSubsystem::Auth_ReportNoise(AActor* NoiseMaker, const FVector& Location, float Loudness, APawn* Instigator, float MaxRange, FName Tag)
+{
+	if (!NoiseMaker)
+	{
+		return;
+	}
+
+	if (UShooterNoiseSubsystem* Noises = NoiseMaker->GetWorld()->GetSubsystem<UShooterNoiseSubsystem>())
+	{
+		Noises->Auth_ReportNoise(Location, Loudness, Instigator, MaxRange, Tag);
+		return;
+	}
+
+	// no aggregator in this world, so report the noise as is
+	NoiseMaker->MakeNoise(Loudness, Instigator, Location, MaxRange, Tag);
+	UShooterAISense_Hearing::ReportNoiseEvent(NoiseMaker, Location, Loudness, Instigator, MaxRange, Tag);
+
+	if (UShooterAILODSubsystem* AILOD = NoiseMaker->GetWorld()->GetSubsystem<UShooterAILODSubsystem>())
+	{
+		AILOD->Auth_ReportNoise(Location, MaxRange);
+	}
+}
+
+bool UShooterNoiseSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterNoiseSubsystem::Tick(float DeltaTime)
+{
+	ReportAllowance = FMath::Min(ReportAllowance + DeltaTime * MaxReportsPerSecond, static_cast<float>(MaxReportBurst));
+
+	if (PendingNoises.Num() == 0)
+	{
+		return;
+	}
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	// gather the noises whose merge window has closed
+	TArray<TPair<double, FNoiseKey>, TInlineAllocator<32>> ReadyNoises;
+
+	for (const TPair<FNoiseKey, FPendingNoise>& Pair : PendingNoises)
+	{
+		if (Now - Pair.Value.FirstTime >= MergeWindow)
+		{
+			ReadyNoises.Emplace(Pair.Value.FirstTime, Pair.Key);
+		}
+	}
+
+	const int32 NumReports = FMath::Min(ReadyNoises.Num(), FMath::FloorToInt32(ReportAllowance));
+
+	if (NumReports <= 0)
+	{
+		return;
+	}
+
+	// the oldest noises go first, the rest keep merging until the next frame
+	ReadyNoises.Sort([](const TPair<double, FNoiseKey>& A, const TPair<double, FNoiseKey>& B) { return A.Key < B.Key; });
+
+	for (int32 i = 0; i < NumReports; ++i)
+	{
+		FPendingNoise Noise;
+
+		if (PendingNoises.RemoveAndCopyValue(ReadyNoises[i].Value, Noise))
+		{
+			ReportMergedNoise(ReadyNoises[i].Value, Noise);
+		}
+	}
+
+	ReportAllowance -= NumReports;
+}
+
+TStatId UShooterNoiseSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterNoiseSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterNoiseSubsystem::ReportMergedNoise(const FNoiseKey& Key, const FPendingNoise& Noise)
+{
+	const FVector Location = Noise.WeightedLocation / Noise.LoudnessSum;
+
+	// merged noises are louder than any one of them, but only up to a point
+	const float Loudness = FMath::Min(FMath::Sqrt(Noise.LoudnessSquaredSum), Noise.MaxLoudness * MaxLoudnessGain);
+
+	// listeners use either the default hearing sense or the spatially partitioned one, so tell both
+	UAISense_Hearing::ReportNoiseEvent(GetWorld(), Location, Loudness, Noise.Instigator.Get(), Noise.MaxRange, Key.Tag);
+	UShooterAISense_Hearing::ReportNoiseEvent(GetWorld(), Location, Loudness, Noise.Instigator.Get(), Noise.MaxRange, Key.Tag);
+
+	// wake up hibernating NPCs in earshot so they can perceive what follows
+	if (UShooterAILODSubsystem* AILOD = GetWorld()->GetSubsystem<UShooterAILODSubsystem>())
+	{
+		AILOD->Auth_ReportNoise(Location, Noise.MaxRange);
+	}
+}
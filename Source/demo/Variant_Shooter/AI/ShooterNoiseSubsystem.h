@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "ShooterNoiseSubsystem.generated.h"
+
+/**
+ *  Server-side noise aggregator for AI hearing
+ *  Noises from the same instigator with the same tag in the same cell are merged for a short window into a single
+ *  event with the combined loudness. Merged events are passed on to the perception system at a bounded rate,
+ *  oldest first. Events held back by the rate limit keep absorbing new noises until they go out
+ */
+UCLASS(config=Game)
+class DEMO_API UShooterNoiseSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Identifies the noises that get merged together */
+	struct FNoiseKey
+	{
+		TObjectKey<AActor> Instigator;
+		FIntVector Cell = FIntVector::ZeroValue;
+		FName Tag;
+
+		bool operator==(const FNoiseKey& Other) const
+		{
+			return Instigator == Other.Instigator && Cell == Other.Cell && Tag == Other.Tag;
+		}
+
+		friend uint32 GetTypeHash(const FNoiseKey& Key)
+		{
+			return HashCombine(HashCombine(GetTypeHash(Key.Instigator), GetTypeHash(Key.Cell)), GetTypeHash(Key.Tag));
+		}
+	};
+
+	/** A merged noise waiting to be reported */
+	struct FPendingNoise
+	{
+		/** Pawn responsible for the noise */
+		TWeakObjectPtr<APawn> Instigator;
+
+		/** Loudness weighted sum of the noise locations */
+		FVector WeightedLocation = FVector::ZeroVector;
+
+		/** Sum of the loudness of the merged noises */
+		float LoudnessSum = 0.0f;
+
+		/** Sum of the squared loudness of the merged noises */
+		float LoudnessSquaredSum = 0.0f;
+
+		/** Loudest merged noise */
+		float MaxLoudness = 0.0f;
+
+		/** Largest max range of the merged noises. Zero means unlimited */
+		float MaxRange = 0.0f;
+
+		/** Time the first noise was merged in */
+		double FirstTime = 0.0;
+	};
+
+	/** Size of the cells noises are merged in */
+	UPROPERTY(Config)
+	float CellSize = 300.0f;
+
+	/** Time noises are merged for before the event is reported */
+	UPROPERTY(Config)
+	float MergeWindow = 0.15f;
+
+	/** Max loudness of a merged event, as a multiple of its loudest noise */
+	UPROPERTY(Config)
+	float MaxLoudnessGain = 2.0f;
+
+	/** Max number of events reported to the perception system per second */
+	UPROPERTY(Config)
+	float MaxReportsPerSecond = 60.0f;
+
+	/** Max number of events reported in a single frame */
+	UPROPERTY(Config)
+	int32 MaxReportBurst = 8;
+
+	/** Noises being merged */
+	TMap<FNoiseKey, FPendingNoise> PendingNoises;
+
+	/** Number of events that can still be reported, refilled over time */
+	float ReportAllowance = 0.0f;
+
+public:
+
+	/**
+	 * @brief Queues a noise for AI hearing, merging it with similar recent noises
+	 * @param Location where the noise was made
+	 * @param Loudness loudness of the noise
+	 * @param Instigator pawn responsible for the noise
+	 * @param MaxRange max hearing range. Zero means unlimited
+	 * @param Tag noise tag passed on to the perception system
+	 */
+	void Auth_ReportNoise(const FVector& Location, float Loudness, APawn* Instigator, float MaxRange, FName Tag);
+
+	/** Reports a noise through the subsystem if there is one, or straight to the perception system otherwise */
+	static void Auth_ReportNoise(AActor* NoiseMaker, const FVector& Location, float Loudness, APawn* Instigator, float MaxRange, FName Tag);
+
+	/** Returns the number of merged noises waiting to be reported */
+	int32 GetNumPendingNoises() const { return PendingNoises.Num(); }
+
+protected:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+
+	/** Passes a merged noise on to the perception system and wakes the hibernating NPCs in earshot */
+	void ReportMergedNoise(const FNoiseKey& Key, const FPendingNoise& Noise);
+};
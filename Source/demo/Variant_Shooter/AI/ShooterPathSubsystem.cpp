@@ -0,0 +1,427 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/AI/ShooterPathSubsystem.h"
+#include "ShooterAIController.h"
+#include "NavigationSystem.h"
+#include "NavMesh/NavMeshPath.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "Engine/World.h"
+
+uint32 UShooterPathSubsystem::Auth_RequestPath(AShooterAIController* Controller, const FVector& Goal, FShooterPathReadyDelegate OnReady)
+{
+	FPathRequest& Request = QueuedRequests.AddDefaulted_GetRef();
+	Request.Id = ++LastRequestId;
+	Request.Controller = Controller;
+	Request.Goal = Goal;
+	Request.GoalCell = GetGoalCell(Goal);
+	Request.OnReady = MoveTemp(OnReady);
+
+	return Request.Id;
+}
+
+void UShooterPathSubsystem::Auth_CancelRequest(uint32 RequestId)
+{
+	if (QueuedRequests.RemoveAll([RequestId](const FPathRequest& Request) { return Request.Id == RequestId; }) > 0)
+	{
+		return;
+	}
+
+	// the query keeps running for the others waiting on it
+	for (TPair<uint32, FPendingQuery>& Pair : PendingQueries)
+	{
+		if (Pair.Value.Requests.RemoveAll([RequestId](const FPathRequest& Request) { return Request.Id == RequestId; }) > 0)
+		{
+			return;
+		}
+	}
+}
+
+bool UShooterPathSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterPathSubsystem::Tick(float DeltaTime)
+{
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	// drop paths that expired, or that were invalidated because the tiles along them changed
+	for (auto It = PathCache.CreateIterator(); It; ++It)
+	{
+		It.Value().RemoveAll([this, Now](const FCachedPath& Cached) { return !IsCachedPathUsable(*Cached.Path) || Now - Cached.Time > CacheLifetime; });
+
+		if (It.Value().Num() == 0)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	if (QueuedRequests.Num() == 0)
+	{
+		return;
+	}
+
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	ANavigationData* NavData = GetNavData();
+
+	// no navigation, no paths
+	if (!NavSys || !NavData)
+	{
+		for (FPathRequest& Request : QueuedRequests)
+		{
+			Request.OnReady.ExecuteIfBound(nullptr);
+		}
+
+		QueuedRequests.Reset();
+		return;
+	}
+
+	// take the batch out, failed joins requeue themselves while we process it
+	TArray<FPathRequest> Batch = MoveTemp(QueuedRequests);
+	QueuedRequests.Reset();
+
+	int32 NumQueriesStarted = 0;
+
+	for (FPathRequest& Request : Batch)
+	{
+		AShooterAIController* Controller = Request.Controller.Get();
+
+		if (!Controller || !Controller->GetPawn())
+		{
+			continue;
+		}
+
+		if (!Request.bOwnQuery && ServeFromCache(Request, *NavData))
+		{
+			continue;
+		}
+
+		// wait on a query that's already heading to the same region
+		FPendingQuery* SharedQuery = nullptr;
+
+		for (TPair<uint32, FPendingQuery>& Pair : PendingQueries)
+		{
+			if (!Request.bOwnQuery && Pair.Value.GoalCell == Request.GoalCell)
+			{
+				SharedQuery = &Pair.Value;
+				break;
+			}
+		}
+
+		if (SharedQuery)
+		{
+			SharedQuery->Requests.Add(MoveTemp(Request));
+			continue;
+		}
+
+		// over budget, try again next frame
+		if (NumQueriesStarted >= MaxQueriesPerFrame)
+		{
+			QueuedRequests.Add(MoveTemp(Request));
+			continue;
+		}
+
+		// run the search on the navigation worker threads
+		const FPathFindingQuery Query(Controller, *NavData, Controller->GetNavAgentLocation(), Request.Goal, NavData->GetDefaultQueryFilter());
+		const uint32 QueryId = NavSys->FindPathAsync(Controller->GetNavAgentPropertiesRef(), Query, FNavPathQueryDelegate::CreateUObject(this, &UShooterPathSubsystem::OnQueryFinished));
+
+		FPendingQuery& Pending = PendingQueries.Add(QueryId);
+		Pending.GoalCell = Request.GoalCell;
+		Pending.OwnerId = Request.Id;
+		Pending.Requests.Add(MoveTemp(Request));
+
+		++NumQueriesStarted;
+	}
+}
+
+TStatId UShooterPathSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterPathSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterPathSubsystem::OnQueryFinished(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr Path)
+{
+	FPendingQuery Pending;
+
+	if (!PendingQueries.RemoveAndCopyValue(QueryId, Pending))
+	{
+		return;
+	}
+
+	ANavigationData* NavData = GetNavData();
+
+	// if the goal region can't be reached from one start, it most likely can't be reached from the others
+	if (Result != ENavigationQueryResult::Success || !Path.IsValid() || !NavData)
+	{
+		for (FPathRequest& Request : Pending.Requests)
+		{
+			Request.OnReady.ExecuteIfBound(nullptr);
+		}
+
+		return;
+	}
+
+	// partial paths end short of the goal, so only the request they were found for can use them
+	const bool bPartial = Path->IsPartial();
+
+	FPathRequest* Owner = nullptr;
+
+	for (FPathRequest& Request : Pending.Requests)
+	{
+		if (!Request.Controller.IsValid() || !Request.Controller->GetPawn())
+		{
+			continue;
+		}
+
+		FNavPathSharedPtr JoinedPath = bPartial ? nullptr : BuildJoinedPath(*Path, Request, *NavData);
+
+		if (JoinedPath)
+		{
+			Request.OnReady.ExecuteIfBound(JoinedPath);
+
+		} else if (Request.Id == Pending.OwnerId) {
+
+			// the query started from this request, so its path is the answer even if we couldn't copy it
+			Owner = &Request;
+
+		} else {
+
+			// requests that started too far from this path get their own query next frame
+			Request.bOwnQuery = true;
+			QueuedRequests.Add(MoveTemp(Request));
+		}
+	}
+
+	// hand the path out last, since it belongs to the owner's path following component from then on
+	if (Owner)
+	{
+		Owner->OnReady.ExecuteIfBound(Path);
+		return;
+	}
+
+	if (bPartial)
+	{
+		return;
+	}
+
+	// have the navigation data invalidate the path if the tiles along it change. Nobody follows the cached
+	// path itself, so it shouldn't be repathed from wherever the query started, just dropped
+	Path->EnableRecalculationOnInvalidation(false);
+	NavData->RegisterActivePath(Path);
+
+	TArray<FCachedPath>& CachedPaths = PathCache.FindOrAdd(Pending.GoalCell);
+
+	if (CachedPaths.Num() >= MaxPathsPerGoal)
+	{
+		CachedPaths.RemoveAt(0);
+	}
+
+	FCachedPath& Cached = CachedPaths.AddDefaulted_GetRef();
+	Cached.Path = Path;
+	Cached.Time = GetWorld()->GetTimeSeconds();
+}
+
+bool UShooterPathSubsystem::ServeFromCache(FPathRequest& Request, ANavigationData& NavData)
+{
+	TArray<FCachedPath>* CachedPaths = PathCache.Find(Request.GoalCell);
+
+	if (!CachedPaths)
+	{
+		return false;
+	}
+
+	// newest paths first
+	for (int32 i = CachedPaths->Num() - 1; i >= 0; --i)
+	{
+		const FNavigationPath* Cached = (*CachedPaths)[i].Path.Get();
+
+		// the tiles may have changed since the last tick
+		if (!IsCachedPathUsable(*Cached))
+		{
+			CachedPaths->RemoveAt(i);
+			continue;
+		}
+
+		if (FNavPathSharedPtr JoinedPath = BuildJoinedPath(*Cached, Request, NavData))
+		{
+			Request.OnReady.ExecuteIfBound(JoinedPath);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool UShooterPathSubsystem::IsCachedPathUsable(const FNavigationPath& Cached)
+{
+	return Cached.IsValid() && Cached.IsUpToDate();
+}
+
+FNavPathSharedPtr UShooterPathSubsystem::BuildJoinedPath(const FNavigationPath& Cached, const FPathRequest& Request, ANavigationData& NavData) const
+{
+	const TArray<FNavPathPoint>& Points = Cached.GetPathPoints();
+
+	if (Points.Num() < 2)
+	{
+		return nullptr;
+	}
+
+	AShooterAIController* Controller = Request.Controller.Get();
+	const FVector Start = Controller->GetNavAgentLocation();
+
+	// join the path at the closest point
+	int32 JoinIndex = INDEX_NONE;
+	float JoinDistanceSquared = FMath::Square(JoinDistance);
+
+	for (int32 i = 0; i < Points.Num(); ++i)
+	{
+		const float DistanceSquared = FVector::DistSquared(Points[i].Location, Start);
+
+		if (DistanceSquared < JoinDistanceSquared)
+		{
+			JoinIndex = i;
+			JoinDistanceSquared = DistanceSquared;
+		}
+	}
+
+	if (JoinIndex == INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	// joined paths need a corridor for crowd following, which only navmesh paths have
+	const ARecastNavMesh* NavMesh = Cast<ARecastNavMesh>(&NavData);
+	const FNavMeshPath* CachedMeshPath = Cached.CastPath<FNavMeshPath>();
+
+	if (!NavMesh || !CachedMeshPath || CachedMeshPath->PathCorridor.Num() == 0)
+	{
+		return nullptr;
+	}
+
+	const FVector QueryExtent = NavData.GetConfig().DefaultQueryExtent;
+	const FSharedConstNavQueryFilter QueryFilter = NavData.GetDefaultQueryFilter();
+
+	FNavLocation StartLocation;
+
+	if (!NavData.ProjectPoint(Start, StartLocation, QueryExtent, QueryFilter, Controller))
+	{
+		return nullptr;
+	}
+
+	// we must be able to walk straight onto the path. The polys we cross start our corridor
+	TArray<NavNodeRef> Corridor;
+
+	if (!RaycastCorridor(*NavMesh, StartLocation.Location, Points[JoinIndex].Location, Controller, Corridor))
+	{
+		return nullptr;
+	}
+
+	// carry on along the cached corridor from the poly we join it on
+	const int32 CorridorJoin = CachedMeshPath->PathCorridor.Find(Corridor.Last());
+
+	if (CorridorJoin == INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	Corridor.Append(CachedMeshPath->PathCorridor.GetData() + CorridorJoin + 1, CachedMeshPath->PathCorridor.Num() - CorridorJoin - 1);
+
+	// and straight from its end to our own goal within the region
+	const bool bSameGoal = FVector::DistSquared(Points.Last().Location, Request.Goal) < FMath::Square(10.0f);
+
+	FNavLocation GoalLocation;
+
+	if (!bSameGoal)
+	{
+		if (!NavData.ProjectPoint(Request.Goal, GoalLocation, QueryExtent, QueryFilter, Controller))
+		{
+			return nullptr;
+		}
+
+		TArray<NavNodeRef> GoalCorridor;
+
+		if (!RaycastCorridor(*NavMesh, Points.Last().Location, GoalLocation.Location, Controller, GoalCorridor))
+		{
+			return nullptr;
+		}
+
+		// the goal leg starts on the poly the cached corridor ends on
+		for (NavNodeRef Poly : GoalCorridor)
+		{
+			if (Poly != Corridor.Last())
+			{
+				Corridor.Add(Poly);
+			}
+		}
+	}
+
+	// build a copy, since the path following component will make the path its own
+	FNavMeshPath* MeshPath = new FNavMeshPath();
+	FNavPathSharedPtr NewPath = MakeShareable(MeshPath);
+
+	TArray<FNavPathPoint>& NewPoints = NewPath->GetPathPoints();
+	NewPoints.Add(FNavPathPoint(StartLocation.Location, StartLocation.NodeRef));
+
+	// skip the join point if we're standing on it
+	const int32 FirstPoint = FVector::DistSquared(Points[JoinIndex].Location, StartLocation.Location) < 1.0f && JoinIndex + 1 < Points.Num() ? JoinIndex + 1 : JoinIndex;
+
+	for (int32 i = FirstPoint; i < Points.Num(); ++i)
+	{
+		NewPoints.Add(Points[i]);
+	}
+
+	if (!bSameGoal)
+	{
+		NewPoints.Add(FNavPathPoint(GoalLocation.Location, GoalLocation.NodeRef));
+	}
+
+	MeshPath->PathCorridor = MoveTemp(Corridor);
+
+	NewPath->SetNavigationDataUsed(&NavData);
+	NewPath->SetQuerier(Controller);
+	NewPath->SetTimeStamp(NavData.GetWorldTimeStamp());
+	NewPath->MarkReady();
+
+	return NewPath;
+}
+
+bool UShooterPathSubsystem::RaycastCorridor(const ARecastNavMesh& NavMesh, const FVector& From, const FVector& To, const AShooterAIController* Querier, TArray<NavNodeRef>& OutCorridor) const
+{
+	FRaycastResult Result;
+	FVector HitLocation;
+
+	ARecastNavMesh::NavMeshRaycast(&NavMesh, From, To, HitLocation, NavMesh.GetDefaultQueryFilter(), Querier, Result);
+
+	// a full corridor buffer means the ray was cut short
+	if (Result.HasHit() || Result.CorridorPolysCount == 0 || Result.CorridorPolysCount >= FRaycastResult::MAX_PATH_CORRIDOR_POLYS)
+	{
+		return false;
+	}
+
+	for (int32 i = 0; i < Result.CorridorPolysCount; ++i)
+	{
+		// don't repeat the poly the previous leg ended on
+		if (OutCorridor.Num() == 0 || OutCorridor.Last() != Result.CorridorPolys[i])
+		{
+			OutCorridor.Add(Result.CorridorPolys[i]);
+		}
+	}
+
+	return true;
+}
+
+ANavigationData* UShooterPathSubsystem::GetNavData() const
+{
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+
+	return NavSys ? NavSys->GetDefaultNavDataInstance(FNavigationSystem::DontCreate) : nullptr;
+}
+
+FIntVector UShooterPathSubsystem::GetGoalCell(const FVector& Location) const
+{
+	return FIntVector(
+		FMath::FloorToInt(Location.X / GoalCellSize),
+		FMath::FloorToInt(Location.Y / GoalCellSize),
+		FMath::FloorToInt(Location.Z / GoalCellSize));
+}
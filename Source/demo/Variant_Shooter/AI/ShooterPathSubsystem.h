@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "NavigationData.h"
+#include "ShooterPathSubsystem.generated.h"
+
+class AShooterAIController;
+class ARecastNavMesh;
+
+/** Called when a path request completes. The path is null if no path was found */
+DECLARE_DELEGATE_OneParam(FShooterPathReadyDelegate, FNavPathSharedPtr);
+
+/**
+ *  Server-side path service for NPCs
+ *  Path requests made during a frame are batched and run as async pathfinding queries, up to a per-frame limit
+ *  Requests towards the same goal region share a single query, and later requests reuse the goal side of
+ *  cached paths when they can walk straight onto them. Cached paths are dropped when the navmesh tiles along them change
+ *  Partial paths are never shared, and a request that can't use a shared path runs its own query
+ *  Assumes all NPCs share the same navigation agent
+ */
+UCLASS(config=Game)
+class DEMO_API UShooterPathSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** A queued path request */
+	struct FPathRequest
+	{
+		/** Request ID, for cancelling */
+		uint32 Id = 0;
+
+		/** Requesting controller */
+		TWeakObjectPtr<AShooterAIController> Controller;
+
+		/** Goal location */
+		FVector Goal = FVector::ZeroVector;
+
+		/** Goal region the request belongs to */
+		FIntVector GoalCell = FIntVector::ZeroValue;
+
+		/** Completion callback */
+		FShooterPathReadyDelegate OnReady;
+
+		/** If true, the request skips the cache and other queries and runs its own. Set once a shared path didn't work for it */
+		bool bOwnQuery = false;
+	};
+
+	/** An async pathfinding query in flight, and the requests waiting on it */
+	struct FPendingQuery
+	{
+		/** Goal region of the query */
+		FIntVector GoalCell = FIntVector::ZeroValue;
+
+		/** Request the query was started for. It gets the query's path even if it can't be copied */
+		uint32 OwnerId = 0;
+
+		/** Requests to serve once the query completes */
+		TArray<FPathRequest> Requests;
+	};
+
+	/** A cached path to a goal region */
+	struct FCachedPath
+	{
+		/** Cached path. Never handed out directly, requests get copies */
+		FNavPathSharedPtr Path;
+
+		/** Time the path was found */
+		double Time = 0.0;
+	};
+
+	/** Size of the goal regions whose requests share paths */
+	UPROPERTY(Config)
+	float GoalCellSize = 200.0f;
+
+	/** Max distance between a request's start and a cached path point for the request to join the path there */
+	UPROPERTY(Config)
+	float JoinDistance = 400.0f;
+
+	/** Time paths stay cached if their tiles don't change */
+	UPROPERTY(Config)
+	float CacheLifetime = 10.0f;
+
+	/** Max number of cached paths per goal region */
+	UPROPERTY(Config)
+	int32 MaxPathsPerGoal = 4;
+
+	/** Max number of async queries started per frame */
+	UPROPERTY(Config)
+	int32 MaxQueriesPerFrame = 8;
+
+	/** Requests waiting for the next batch */
+	TArray<FPathRequest> QueuedRequests;
+
+	/** Queries in flight, keyed by their navigation query ID */
+	TMap<uint32, FPendingQuery> PendingQueries;
+
+	/** Cached paths per goal region */
+	TMap<FIntVector, TArray<FCachedPath>> PathCache;
+
+	/** Last request ID handed out */
+	uint32 LastRequestId = 0;
+
+public:
+
+	/**
+	 * @brief Queues a path request for the next batch
+	 * @param Controller controller to find a path for, starting at its pawn
+	 * @param Goal location to path to
+	 * @param OnReady called with the path once it's found, or with null if there's no path
+	 * @return request ID, for cancelling
+	 */
+	uint32 Auth_RequestPath(AShooterAIController* Controller, const FVector& Goal, FShooterPathReadyDelegate OnReady);
+
+	/** Cancels a path request. Its callback won't be called */
+	void Auth_CancelRequest(uint32 RequestId);
+
+protected:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+
+	/** Handles a finished async query */
+	void OnQueryFinished(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr Path);
+
+	/** Serves a request from the cache. Returns false if no cached path can be reused */
+	bool ServeFromCache(FPathRequest& Request, ANavigationData& NavData);
+
+	/** Returns true if a cached path hasn't been invalidated by navmesh changes */
+	static bool IsCachedPathUsable(const FNavigationPath& Cached);
+
+	/** Builds a copy of a cached path, starting at the request's pawn and joining the path at the nearest reachable point. Returns null if it can't join */
+	FNavPathSharedPtr BuildJoinedPath(const FNavigationPath& Cached, const FPathRequest& Request, ANavigationData& NavData) const;
+
+	/**
+	 * @brief Raycasts along the navmesh and collects the polys crossed, so joined paths keep a gapless corridor
+	 * @param NavMesh navmesh to raycast on
+	 * @param From ray start
+	 * @param To ray end
+	 * @param Querier controller the raycast is for
+	 * @param OutCorridor polys crossed, appended in order
+	 * @return false if the ray is blocked or crosses too many polys
+	 */
+	bool RaycastCorridor(const ARecastNavMesh& NavMesh, const FVector& From, const FVector& To, const AShooterAIController* Querier, TArray<NavNodeRef>& OutCorridor) const;
+
+	/** Returns the navigation data for NPCs */
+	ANavigationData* GetNavData() const;
+
+	/** Returns the goal region for a location */
+	FIntVector GetGoalCell(const FVector& Location) const;
+};
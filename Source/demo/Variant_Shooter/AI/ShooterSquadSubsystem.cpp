@@ -0,0 +1,256 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/AI/ShooterSquadSubsystem.h"
+#include "ShooterAIController.h"
+#include "Engine/World.h"
+
+void UShooterSquadSubsystem::Auth_AddMember(AShooterAIController* Controller)
+{
+	// squads are opt-in
+	if (!Controller || Controller->GetSquadId() == 0)
+	{
+		return;
+	}
+
+	Squads.FindOrAdd(GetSquadKey(Controller)).Members.AddUnique(Controller);
+}
+
+void UShooterSquadSubsystem::Auth_RemoveMember(AShooterAIController* Controller)
+{
+	if (FSquad* Squad = FindSquad(Controller))
+	{
+		Squad->Members.RemoveSwap(Controller, EAllowShrinking::No);
+
+		// hand its checks over to someone else right away
+		for (FShooterSquadTargetKnowledge& Knowledge : Squad->Targets)
+		{
+			Knowledge.LineOfSightCheckers.RemoveSwap(Controller, EAllowShrinking::No);
+		}
+	}
+}
+
+void UShooterSquadSubsystem::Auth_ReportSensed(AShooterAIController* Controller, AActor* Target, const FVector& Location)
+{
+	FSquad* Squad = FindSquad(Controller);
+
+	if (!Squad || !IsValid(Target))
+	{
+		return;
+	}
+
+	FShooterSquadTargetKnowledge* Knowledge = Squad->Targets.FindByPredicate([Target](const FShooterSquadTargetKnowledge& Entry) { return Entry.Target.Get() == Target; });
+
+	if (!Knowledge)
+	{
+		Knowledge = &Squad->Targets.AddDefaulted_GetRef();
+		Knowledge->Target = Target;
+
+		// whoever saw it first checks on it until the next assignment
+		Knowledge->LineOfSightCheckers.Add(Controller);
+	}
+
+	Knowledge->LastKnownLocation = Location;
+	Knowledge->LastSensedTime = GetWorld()->GetTimeSeconds();
+}
+
+void UShooterSquadSubsystem::Auth_ReportLineOfSight(AShooterAIController* Controller, const FVector& Start, AActor* Target, int32 NumberOfVerticalChecks, bool bVisible)
+{
+	FSquad* Squad = FindSquad(Controller);
+
+	if (!Squad || !IsValid(Target))
+	{
+		return;
+	}
+
+	FShooterSquadTargetKnowledge* Knowledge = Squad->Targets.FindByPredicate([Target](const FShooterSquadTargetKnowledge& Entry) { return Entry.Target.Get() == Target; });
+
+	// only results from designated checkers are shared
+	if (!Knowledge || !Knowledge->LineOfSightCheckers.Contains(Controller) || !Controller->GetPawn())
+	{
+		return;
+	}
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	Knowledge->bVisible = bVisible;
+	Knowledge->VisibilityTime = Now;
+	Knowledge->VisibilityOrigin = Start;
+	Knowledge->VisibilityChecks = NumberOfVerticalChecks;
+
+	// a visible target is as good as sensed
+	if (bVisible)
+	{
+		Knowledge->LastKnownLocation = Target->GetActorLocation();
+		Knowledge->LastSensedTime = Now;
+	}
+}
+
+bool UShooterSquadSubsystem::GetSharedLineOfSight(const AShooterAIController* Controller, const FVector& Start, const AActor* Target, int32 NumberOfVerticalChecks, bool& bOutVisible) const
+{
+	const FShooterSquadTargetKnowledge* Knowledge = FindTargetKnowledge(Controller, Target);
+
+	if (!Knowledge || !Controller->GetPawn())
+	{
+		return false;
+	}
+
+	// checkers always trace for themselves
+	if (Knowledge->LineOfSightCheckers.Contains(Controller))
+	{
+		return false;
+	}
+
+	// stale results and results from far away checkers aren't good enough
+	if (GetWorld()->GetTimeSeconds() - Knowledge->VisibilityTime > SharedLineOfSightValidity)
+	{
+		return false;
+	}
+
+	// the result only holds for a similar trace: from about the same spot and height, with the same checks
+	if (Knowledge->VisibilityChecks != NumberOfVerticalChecks || FVector::DistSquared(Start, Knowledge->VisibilityOrigin) > FMath::Square(MaxLineOfSightShareDistance))
+	{
+		return false;
+	}
+
+	bOutVisible = Knowledge->bVisible;
+	return true;
+}
+
+AActor* UShooterSquadSubsystem::GetSharedTarget(const AShooterAIController* Controller) const
+{
+	const FSquad* Squad = FindSquad(Controller);
+
+	if (!Squad || !Controller->GetPawn())
+	{
+		return nullptr;
+	}
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	const FVector MemberLocation = Controller->GetPawn()->GetActorLocation();
+
+	AActor* BestTarget = nullptr;
+	double BestTime = -UE_BIG_NUMBER;
+
+	for (const FShooterSquadTargetKnowledge& Knowledge : Squad->Targets)
+	{
+		// only share targets someone can currently see
+		if (!Knowledge.bVisible || Now - Knowledge.VisibilityTime > SharedLineOfSightValidity)
+		{
+			continue;
+		}
+
+		// members far from the action keep doing their own thing
+		if (FVector::DistSquared(MemberLocation, Knowledge.LastKnownLocation) > FMath::Square(MaxTargetShareDistance))
+		{
+			continue;
+		}
+
+		if (Knowledge.VisibilityTime > BestTime && Knowledge.Target.IsValid())
+		{
+			BestTarget = Knowledge.Target.Get();
+			BestTime = Knowledge.VisibilityTime;
+		}
+	}
+
+	return BestTarget;
+}
+
+const FShooterSquadTargetKnowledge* UShooterSquadSubsystem::FindTargetKnowledge(const AShooterAIController* Controller, const AActor* Target) const
+{
+	const FSquad* Squad = FindSquad(Controller);
+
+	if (!Squad || !Target)
+	{
+		return nullptr;
+	}
+
+	return Squad->Targets.FindByPredicate([Target](const FShooterSquadTargetKnowledge& Entry) { return Entry.Target.Get() == Target; });
+}
+
+bool UShooterSquadSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterSquadSubsystem::Tick(float DeltaTime)
+{
+	TimeUntilAssignment -= DeltaTime;
+
+	if (TimeUntilAssignment > 0.0f)
+	{
+		return;
+	}
+
+	TimeUntilAssignment = AssignmentInterval;
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	for (auto It = Squads.CreateIterator(); It; ++It)
+	{
+		FSquad& Squad = It.Value();
+
+		// drop members that went away
+		Squad.Members.RemoveAllSwap([](const TWeakObjectPtr<AShooterAIController>& Member) { return !Member.IsValid() || !Member->GetPawn(); }, EAllowShrinking::No);
+
+		if (Squad.Members.Num() == 0)
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		// forget targets nobody has sensed in a while
+		Squad.Targets.RemoveAllSwap([this, Now](const FShooterSquadTargetKnowledge& Knowledge) { return !Knowledge.Target.IsValid() || Now - Knowledge.LastSensedTime > KnowledgeLifetime; }, EAllowShrinking::No);
+
+		AssignCheckers(Squad);
+	}
+}
+
+TStatId UShooterSquadSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterSquadSubsystem, STATGROUP_Tickables);
+}
+
+UShooterSquadSubsystem::FSquad* UShooterSquadSubsystem::FindSquad(const AShooterAIController* Controller)
+{
+	return Controller && Controller->GetSquadId() != 0 ? Squads.Find(GetSquadKey(Controller)) : nullptr;
+}
+
+const UShooterSquadSubsystem::FSquad* UShooterSquadSubsystem::FindSquad(const AShooterAIController* Controller) const
+{
+	return Controller && Controller->GetSquadId() != 0 ? Squads.Find(GetSquadKey(Controller)) : nullptr;
+}
+
+uint16 UShooterSquadSubsystem::GetSquadKey(const AShooterAIController* Controller)
+{
+	return static_cast<uint16>(Controller->GetGenericTeamId().GetId()) << 8 | Controller->GetSquadId();
+}
+
+void UShooterSquadSubsystem::AssignCheckers(FSquad& Squad)
+{
+	const int32 NumCheckers = FMath::Min(MaxLineOfSightCheckersPerTarget, Squad.Members.Num());
+
+	// members sorted by distance to each target. Reused across targets
+	TArray<TPair<float, AShooterAIController*>, TInlineAllocator<16>> Candidates;
+
+	for (FShooterSquadTargetKnowledge& Knowledge : Squad.Targets)
+	{
+		Candidates.Reset();
+
+		for (const TWeakObjectPtr<AShooterAIController>& Member : Squad.Members)
+		{
+			const float DistanceSquared = FVector::DistSquared(Member->GetPawn()->GetActorLocation(), Knowledge.LastKnownLocation);
+			Candidates.Emplace(DistanceSquared, Member.Get());
+		}
+
+		// the closest members have the best chance to see the target
+		Candidates.Sort([](const TPair<float, AShooterAIController*>& A, const TPair<float, AShooterAIController*>& B) { return A.Key < B.Key; });
+
+		Knowledge.LineOfSightCheckers.Reset();
+
+		for (int32 i = 0; i < NumCheckers; ++i)
+		{
+			Knowledge.LineOfSightCheckers.Add(Candidates[i].Value);
+		}
+	}
+}
@@ -0,0 +1,149 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterSquadSubsystem.generated.h"
+
+class AShooterAIController;
+
+/**
+ *  What a squad knows about one of its targets
+ */
+struct FShooterSquadTargetKnowledge
+{
+	/** Known target */
+	TWeakObjectPtr<AActor> Target;
+
+	/** Last location the target was sensed at by any member */
+	FVector LastKnownLocation = FVector::ZeroVector;
+
+	/** Last time any member sensed the target */
+	double LastSensedTime = 0.0;
+
+	/** Latest line of sight result reported by a checker */
+	bool bVisible = false;
+
+	/** Time of the latest line of sight result */
+	double VisibilityTime = -UE_BIG_NUMBER;
+
+	/** Trace start of the latest line of sight result */
+	FVector VisibilityOrigin = FVector::ZeroVector;
+
+	/** Number of vertical checks the latest line of sight result was traced with */
+	int32 VisibilityChecks = 0;
+
+	/** Members designated to run line of sight checks against this target */
+	TArray<TWeakObjectPtr<AShooterAIController>, TInlineAllocator<2>> LineOfSightCheckers;
+};
+
+/**
+ *  Server-side shared perception for NPC squads
+ *  Members of a squad publish the targets they sense once, and the rest of the squad reads them back.
+ *  Only a couple of members per target are designated to run line of sight checks, the rest reuse their results
+ *  Squads are made of the controllers that share a team and a non-zero squad ID
+ */
+UCLASS(config=Game)
+class DEMO_API UShooterSquadSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Members and shared knowledge of a squad */
+	struct FSquad
+	{
+		/** Registered members */
+		TArray<TWeakObjectPtr<AShooterAIController>> Members;
+
+		/** Known targets */
+		TArray<FShooterSquadTargetKnowledge> Targets;
+	};
+
+	/** Max number of members that run line of sight checks against the same target */
+	UPROPERTY(Config)
+	int32 MaxLineOfSightCheckersPerTarget = 2;
+
+	/** Time a line of sight result is shared with the rest of the squad */
+	UPROPERTY(Config)
+	float SharedLineOfSightValidity = 0.3f;
+
+	/** Max distance between a member's trace start and the checker's for the member to reuse the checker's line of sight result */
+	UPROPERTY(Config)
+	float MaxLineOfSightShareDistance = 300.0f;
+
+	/** Max distance from a member to a target's last known location for the member to pick up the target from the squad */
+	UPROPERTY(Config)
+	float MaxTargetShareDistance = 3000.0f;
+
+	/** Time a target is remembered after the last member sensed it */
+	UPROPERTY(Config)
+	float KnowledgeLifetime = 5.0f;
+
+	/** Time between line of sight checker assignments */
+	UPROPERTY(Config)
+	float AssignmentInterval = 0.5f;
+
+	/** Squads, keyed by team and squad ID */
+	TMap<uint16, FSquad> Squads;
+
+	/** Time left until the next checker assignment */
+	float TimeUntilAssignment = 0.0f;
+
+public:
+
+	/** Adds a controller to its squad */
+	void Auth_AddMember(AShooterAIController* Controller);
+
+	/** Removes a controller from its squad */
+	void Auth_RemoveMember(AShooterAIController* Controller);
+
+	/** Publishes a sensed target to the member's squad */
+	void Auth_ReportSensed(AShooterAIController* Controller, AActor* Target, const FVector& Location);
+
+	/**
+	 * @brief Publishes a line of sight result to the member's squad
+	 * @param Controller member reporting
+	 * @param Start location the member traced from
+	 * @param Target target that was checked
+	 * @param NumberOfVerticalChecks number of vertical checks the member traced with
+	 * @param bVisible line of sight result
+	 */
+	void Auth_ReportLineOfSight(AShooterAIController* Controller, const FVector& Start, AActor* Target, int32 NumberOfVerticalChecks, bool bVisible);
+
+	/**
+	 * @brief Reads a line of sight result shared by the member's squad
+	 * @param Controller member asking
+	 * @param Start location the member would trace from
+	 * @param Target target to check
+	 * @param NumberOfVerticalChecks number of vertical checks the member would trace with
+	 * @param bOutVisible shared result, if any
+	 * @return false if the member should run the check itself, either because it's a designated checker or because there's no result traced from close enough with the same checks
+	 */
+	bool GetSharedLineOfSight(const AShooterAIController* Controller, const FVector& Start, const AActor* Target, int32 NumberOfVerticalChecks, bool& bOutVisible) const;
+
+	/** Returns the target the member's squad most recently saw near the member, or nullptr */
+	AActor* GetSharedTarget(const AShooterAIController* Controller) const;
+
+	/** Returns the squad's knowledge about a target, or nullptr */
+	const FShooterSquadTargetKnowledge* FindTargetKnowledge(const AShooterAIController* Controller, const AActor* Target) const;
+
+protected:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+
+	/** Returns the squad a controller belongs to, or nullptr if it isn't in a squad */
+	FSquad* FindSquad(const AShooterAIController* Controller);
+	const FSquad* FindSquad(const AShooterAIController* Controller) const;
+
+	/** Returns the squad key for a controller */
+	static uint16 GetSquadKey(const AShooterAIController* Controller);
+
+	/** Picks the members closest to each target as its line of sight checkers */
+	void AssignCheckers(FSquad& Squad);
+};
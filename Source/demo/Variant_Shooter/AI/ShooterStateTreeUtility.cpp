@@ -8,8 +8,194 @@
 #include "AIController.h"
 #include "Perception/AIPerceptionComponent.h"
 #include "ShooterAIController.h"
+#include "ShooterLineOfSightSubsystem.h"
+#include "ShooterSquadSubsystem.h"
+#include "ShooterPathSubsystem.h"
+#include "Navigation/PathFollowingComponent.h"
+#include "NavigationSystem.h"
 #include "StateTreeAsyncExecutionContext.h"
 
+namespace
+{
+	/** Checks line of sight, reusing a squadmate's result when we're not one of the squad's designated checkers for the target */
+	bool HasSquadLineOfSight(AShooterNPC* Character, const FVector& Start, AActor* Target, int32 NumberOfVerticalChecks)
+	{
+		UWorld* World = Character->GetWorld();
+
+		AShooterAIController* Controller = Cast<AShooterAIController>(Character->GetController());
+		UShooterSquadSubsystem* Squads = World->GetSubsystem<UShooterSquadSubsystem>();
+
+		bool bVisible = false;
+
+		if (Squads && Squads->GetSharedLineOfSight(Controller, Start, Target, NumberOfVerticalChecks, bVisible))
+		{
+			return bVisible;
+		}
+
+		// trace ourselves and publish the result for the rest of the squad
+		if (UShooterLineOfSightSubsystem* LineOfSight = World->GetSubsystem<UShooterLineOfSightSubsystem>())
+		{
+			bVisible = LineOfSight->HasLineOfSight(Character, Start, Target, NumberOfVerticalChecks);
+		}
+
+		if (Squads)
+		{
+			Squads->Auth_ReportLineOfSight(Controller, Start, Target, NumberOfVerticalChecks, bVisible);
+		}
+
+		return bVisible;
+	}
+
+	/** A drained perception event, with its actor resolved */
+	struct FMergedPerception
+	{
+		/** Perceived actor. Null if it was destroyed before it was forgotten */
+		AActor* Actor = nullptr;
+
+		/** Location of the strongest stimulus */
+		FVector Location = FVector::ZeroVector;
+
+		/** Strength of the strongest stimulus */
+		float Strength = 0.0f;
+
+		/** If true, the actor was sensed after it was last forgotten */
+		bool bSensed = false;
+
+		/** If true, the actor was forgotten */
+		bool bForgotten = false;
+	};
+
+	/** Drains the controller's perception queue and updates the Sense Enemies outputs with it */
+	void ProcessPerceptionEvents(FStateTreeSenseEnemiesInstanceData& InstanceData)
+	{
+		// the controller already merged the events per actor, so each actor is processed once
+		TArray<FMergedPerception, TInlineAllocator<8>> Merged;
+
+		InstanceData.Controller->DrainPerceptionEvents([&Merged](const FShooterPerceptionEvent& Event)
+		{
+			AActor* Actor = Event.Actor.Get();
+
+			// ignore stimuli from actors that went away
+			if (!Actor && !Event.bForgotten)
+			{
+				return;
+			}
+
+			FMergedPerception& Entry = Merged.AddDefaulted_GetRef();
+			Entry.Actor = Actor;
+			Entry.Location = Event.Location;
+			Entry.Strength = Event.Strength;
+			Entry.bSensed = Event.bSensed && Actor != nullptr;
+			Entry.bForgotten = Event.bForgotten;
+		});
+
+		if (Merged.Num() == 0)
+		{
+			return;
+		}
+
+		// process the forgets first, so an actor sensed again after being forgotten ends up sensed
+		for (const FMergedPerception& Entry : Merged)
+		{
+			// are we forgetting the current target or a partial sense?
+			if (Entry.bForgotten && (Entry.Actor == InstanceData.TargetActor || !IsValid(InstanceData.TargetActor)))
+			{
+				// clear the target
+				InstanceData.TargetActor = nullptr;
+
+				// clear the flags
+				InstanceData.bHasInvestigateLocation = false;
+				InstanceData.bHasTarget = false;
+				InstanceData.bTargetFromSquad = false;
+
+				// reset the stimulus strength
+				InstanceData.LastStimulusStrength = 0.0f;
+
+				// clear the target on the controller
+				InstanceData.Controller->ClearCurrentTarget();
+				InstanceData.Controller->ClearFocus(EAIFocusPriority::Gameplay);
+			}
+		}
+
+		UShooterSquadSubsystem* Squads = InstanceData.Character->GetWorld()->GetSubsystem<UShooterSquadSubsystem>();
+
+		const FVector CharacterLocation = InstanceData.Character->GetActorLocation();
+		const FVector CharacterForward = InstanceData.Character->GetActorForwardVector();
+		const float MaxDot = FMath::Cos(FMath::DegreesToRadians(InstanceData.DirectLineOfSightCone));
+
+		// hostile actors within our perception cone, and the strongest hostile stimulus overall
+		TArray<const FMergedPerception*, TInlineAllocator<8>> Candidates;
+		const FMergedPerception* Strongest = nullptr;
+
+		for (const FMergedPerception& Entry : Merged)
+		{
+			if (!Entry.bSensed || !InstanceData.Controller->IsHostile(Entry.Actor, InstanceData.SenseTag))
+			{
+				continue;
+			}
+
+			// let the rest of the squad know about it
+			if (Squads)
+			{
+				Squads->Auth_ReportSensed(InstanceData.Controller, Entry.Actor, Entry.Location);
+			}
+
+			// infer the angle from the dot product between the character facing and the stimulus direction
+			const FVector StimulusDir = (Entry.Location - CharacterLocation).GetSafeNormal();
+
+			if (FVector::DotProduct(StimulusDir, CharacterForward) >= MaxDot)
+			{
+				Candidates.Add(&Entry);
+			}
+
+			if (!Strongest || Entry.Strength > Strongest->Strength)
+			{
+				Strongest = &Entry;
+			}
+		}
+
+		// trace the strongest candidates first and stop at the first one we can see
+		Candidates.Sort([](const FMergedPerception& A, const FMergedPerception& B) { return A.Strength > B.Strength; });
+
+		for (const FMergedPerception* Candidate : Candidates)
+		{
+			// we have direct line of sight if a trace between the character and the sensed actor's center is unobstructed
+			if (HasSquadLineOfSight(InstanceData.Character, CharacterLocation, Candidate->Actor, 1))
+			{
+				// set the controller's target
+				InstanceData.Controller->SetCurrentTarget(Candidate->Actor);
+
+				// set the task output
+				InstanceData.TargetActor = Candidate->Actor;
+
+				// set the flags
+				InstanceData.bHasTarget = true;
+				InstanceData.bHasInvestigateLocation = false;
+				InstanceData.bTargetFromSquad = false;
+
+				return;
+			}
+		}
+
+		// no direct line of sight. If we already have a target, ignore the partial senses and keep on them
+		if (Strongest && !IsValid(InstanceData.TargetActor))
+		{
+			// is this stimulus stronger than the last one we had?
+			if (Strongest->Strength > InstanceData.LastStimulusStrength)
+			{
+				// update the stimulus strength
+				InstanceData.LastStimulusStrength = Strongest->Strength;
+
+				// set the investigate location
+				InstanceData.InvestigateLocation = Strongest->Location;
+
+				// set the investigate flag
+				InstanceData.bHasInvestigateLocation = true;
+			}
+		}
+	}
+}
+
 bool FStateTreeLineOfSightToTargetCondition::TestCondition(FStateTreeExecutionContext& Context) const
 {
 	const FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
@@ -32,37 +218,13 @@ bool FStateTreeLineOfSightToTargetCondition::TestCondition(FStateTreeExecutionCo
 		return !InstanceData.bMustHaveLineOfSight;
 	}
 
-	// get the target's bounding box
-	FVector CenterOfMass, Extent;
-	InstanceData.Target->GetActorBounds(true, CenterOfMass, Extent, false);
-
-	// divide the vertical extent by the number of line of sight checks we'll do
-	const float ExtentZOffset = Extent.Z * 2.0f / InstanceData.NumberOfVerticalLineOfSightChecks;
-
 	// get the character's camera location as the source for the line checks
 	const FVector Start = InstanceData.Character->GetFirstPersonCameraComponent()->GetComponentLocation();
 
-	// ignore the character and target. We want to ensure there's an unobstructed trace not counting them
-	FCollisionQueryParams QueryParams;
-	QueryParams.AddIgnoredActor(InstanceData.Character);
-	QueryParams.AddIgnoredActor(InstanceData.Target);
-
-	FHitResult OutHit;
-
-	// run a number of vertically offset line traces to the target location
-	for (int32 i = 0; i < InstanceData.NumberOfVerticalLineOfSightChecks - 1; ++i)
+	// check a number of vertically offset line traces to the target location, shared with the squad and other queries through the line of sight cache
+	if (HasSquadLineOfSight(InstanceData.Character, Start, InstanceData.Target, InstanceData.NumberOfVerticalLineOfSightChecks))
 	{
-		// calculate the endpoint for the trace
-		const FVector End = CenterOfMass + FVector(0.0f, 0.0f, Extent.Z - ExtentZOffset * i);
-
-		InstanceData.Character->GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, ECC_Visibility, QueryParams);
-
-		// is the trace unobstructed?
-		if (!OutHit.bBlockingHit)
-		{
-			// we only need one unobstructed trace, so terminate early
-			return InstanceData.bMustHaveLineOfSight;
-		}
+		return InstanceData.bMustHaveLineOfSight;
 	}
 
 	// no line of sight found
@@ -219,148 +381,218 @@ EStateTreeRunStatus FStateTreeSenseEnemiesTask::EnterState(FStateTreeExecutionCo
 		// get the instance data
 		FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
 
-		// bind the perception updated delegate on the controller
-		InstanceData.Controller->OnShooterPerceptionUpdated.BindLambda(
-			[WeakContext = Context.MakeWeakExecutionContext()](AActor* SensedActor, const FAIStimulus& Stimulus)
-			{
-				// get the instance data inside the lambda
-				const FStateTreeStrongExecutionContext StrongContext = WeakContext.MakeStrongExecutionContext();
-
-				if (FInstanceDataType* LambdaInstanceData = StrongContext.GetInstanceDataPtr<FInstanceDataType>())
-				{
-					if (SensedActor->ActorHasTag(LambdaInstanceData->SenseTag))
-					{
-						bool bDirectLOS = false;
-
-						// calculate the direction of the stimulus
-						const FVector StimulusDir = (Stimulus.StimulusLocation - LambdaInstanceData->Character->GetActorLocation()).GetSafeNormal();
-
-						// infer the angle from the dot product between the character facing and the stimulus direction
-						const float DirDot = FVector::DotProduct(StimulusDir, LambdaInstanceData->Character->GetActorForwardVector());
-						const float MaxDot = FMath::Cos(FMath::DegreesToRadians(LambdaInstanceData->DirectLineOfSightCone));
-
-						// is the direction within our perception cone?
-						if (DirDot >= MaxDot)
-						{
-							// run a line trace between the character and the sensed actor
-							FCollisionQueryParams QueryParams;
-							QueryParams.AddIgnoredActor(LambdaInstanceData->Character);
-							QueryParams.AddIgnoredActor(SensedActor);
-
-							FHitResult OutHit;
-
-							// we have direct line of sight if this trace is unobstructed
-							bDirectLOS = !LambdaInstanceData->Character->GetWorld()->LineTraceSingleByChannel(OutHit, LambdaInstanceData->Character->GetActorLocation(), SensedActor->GetActorLocation(), ECC_Visibility, QueryParams);
-
-						}
-
-						// check if we have a direct line of sight to the stimulus
-						if (bDirectLOS)
-						{
-							// set the controller's target
-							LambdaInstanceData->Controller->SetCurrentTarget(SensedActor);
-
-							// set the task output
-							LambdaInstanceData->TargetActor = SensedActor;
-
-							// set the flags
-							LambdaInstanceData->bHasTarget = true;
-							LambdaInstanceData->bHasInvestigateLocation = false;
-
-						// no direct line of sight to target
-						} else {
-
-							// if we already have a target, ignore the partial sense and keep on them
-							if (!IsValid(LambdaInstanceData->TargetActor))
-							{
-								// is this stimulus stronger than the last one we had?
-								if (Stimulus.Strength > LambdaInstanceData->LastStimulusStrength)
-								{
-									// update the stimulus strength
-									LambdaInstanceData->LastStimulusStrength = Stimulus.Strength;
-
-									// set the investigate location
-									LambdaInstanceData->InvestigateLocation = Stimulus.StimulusLocation;
-
-									// set the investigate flag
-									LambdaInstanceData->bHasInvestigateLocation = true;
-								}
-							}
-						}
-					}
-				}
-			}
-		);
+		// drop whatever was perceived while we weren't listening
+		InstanceData.Controller->ClearPerceptionEvents();
+	}
 
-		// bind the perception forgotten delegate on the controller
-		InstanceData.Controller->OnShooterPerceptionForgotten.BindLambda(
-			[WeakContext = Context.MakeWeakExecutionContext()](AActor* SensedActor)
-			{
-				// get the instance data inside the lambda
-				FInstanceDataType* LambdaInstanceData = WeakContext.MakeStrongExecutionContext().GetInstanceDataPtr<FInstanceDataType>();
+	return EStateTreeRunStatus::Running;
+}
 
-				if (!LambdaInstanceData)
-				{
-					return;
-				}
+EStateTreeRunStatus FStateTreeSenseEnemiesTask::Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const
+{
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
 
-				bool bForget = false;
+	// process everything perceived since the last tick in one pass
+	ProcessPerceptionEvents(InstanceData);
 
-				// are we forgetting the current target?
-				if (SensedActor == LambdaInstanceData->TargetActor)
-				{
-					bForget = true;
+	UShooterSquadSubsystem* Squads = InstanceData.Character->GetWorld()->GetSubsystem<UShooterSquadSubsystem>();
 
-				} else {
+	if (!Squads)
+	{
+		return EStateTreeRunStatus::Running;
+	}
 
-					// are we forgetting about a partial sense?
-					if (!IsValid(LambdaInstanceData->TargetActor))
-					{
-						bForget = true;
-					}
-				}
+	// our own perception won't forget a target it never sensed, so drop shared targets once the squad forgets them
+	if (InstanceData.bTargetFromSquad && !Squads->FindTargetKnowledge(InstanceData.Controller, InstanceData.TargetActor))
+	{
+		// clear the target
+		InstanceData.TargetActor = nullptr;
 
-				if (bForget)
-				{
-					// clear the target
-					LambdaInstanceData->TargetActor = nullptr;
+		// clear the flags
+		InstanceData.bHasTarget = false;
+		InstanceData.bTargetFromSquad = false;
 
-					// clear the flags
-					LambdaInstanceData->bHasInvestigateLocation = false;
-					LambdaInstanceData->bHasTarget = false;
+		// clear the target on the controller
+		InstanceData.Controller->ClearCurrentTarget();
+		InstanceData.Controller->ClearFocus(EAIFocusPriority::Gameplay);
+	}
 
-					// reset the stimulus strength
-					LambdaInstanceData->LastStimulusStrength = 0.0f;
+	// pick up a target the rest of the squad can see
+	if (!IsValid(InstanceData.TargetActor))
+	{
+		if (AActor* SharedTarget = Squads->GetSharedTarget(InstanceData.Controller))
+		{
+			// set the controller's target
+			InstanceData.Controller->SetCurrentTarget(SharedTarget);
 
-					// clear the target on the controller
-					LambdaInstanceData->Controller->ClearCurrentTarget();
-					LambdaInstanceData->Controller->ClearFocus(EAIFocusPriority::Gameplay);
-				}
+			// set the task output
+			InstanceData.TargetActor = SharedTarget;
 
-			}
-		);
+			// set the flags
+			InstanceData.bHasTarget = true;
+			InstanceData.bHasInvestigateLocation = false;
+			InstanceData.bTargetFromSquad = true;
+		}
 	}
 
 	return EStateTreeRunStatus::Running;
 }
 
-void FStateTreeSenseEnemiesTask::ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
+#if WITH_EDITOR
+FText FStateTreeSenseEnemiesTask::GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting /*= EStateTreeNodeFormatting::Text*/) const
 {
-	// have we transitioned to another state?
+	return FText::FromString("<b>Sense Enemies</b>");
+}
+#endif // WITH_EDITOR
+
+////////////////////////////////////////////////////////////////////
+
+EStateTreeRunStatus FStateTreeQueryInfluenceMapTask::EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
+{
+	// have we transitioned from another state?
 	if (Transition.ChangeType == EStateTreeStateChangeType::Changed)
 	{
 		// get the instance data
 		FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
 
-		// unbind the perception delegates
-		InstanceData.Controller->OnShooterPerceptionUpdated.Unbind();
-		InstanceData.Controller->OnShooterPerceptionForgotten.Unbind();
+		UWorld* World = InstanceData.Character->GetWorld();
+		UShooterInfluenceMapSubsystem* InfluenceMap = World->GetSubsystem<UShooterInfluenceMapSubsystem>();
+
+		FVector CellLocation;
+
+		if (!InfluenceMap || !InfluenceMap->FindLocation(InstanceData.Query, InstanceData.Origin, InstanceData.SearchRadius, InstanceData.Character->GetActorLocation(), InstanceData.Character->GetTeamByte(), CellLocation))
+		{
+			return EStateTreeRunStatus::Failed;
+		}
+
+		// the map is 2D, so find the navigable spot in the cell
+		UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+		FNavLocation NavLocation;
+
+		if (!NavSys || !NavSys->ProjectPointToNavigation(CellLocation, NavLocation, FVector(200.0f, 200.0f, 500.0f)))
+		{
+			return EStateTreeRunStatus::Failed;
+		}
+
+		InstanceData.OutLocation = NavLocation.Location;
 	}
+
+	return EStateTreeRunStatus::Succeeded;
 }
 
 #if WITH_EDITOR
-FText FStateTreeSenseEnemiesTask::GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting /*= EStateTreeNodeFormatting::Text*/) const
+FText FStateTreeQueryInfluenceMapTask::GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting /*= EStateTreeNodeFormatting::Text*/) const
 {
-	return FText::FromString("<b>Sense Enemies</b>");
+	return FText::FromString("<b>Query Influence Map</b>");
+}
+#endif // WITH_EDITOR
+
+////////////////////////////////////////////////////////////////////
+
+EStateTreeRunStatus FStateTreeShooterMoveToTask::EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
+{
+	// get the instance data
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	InstanceData.bMoving = false;
+	InstanceData.bPathFailed = false;
+
+	UShooterPathSubsystem* PathService = InstanceData.Controller->GetWorld()->GetSubsystem<UShooterPathSubsystem>();
+
+	if (!PathService)
+	{
+		return EStateTreeRunStatus::Failed;
+	}
+
+	// ask the path service for a path. It may come back in a later frame
+	InstanceData.PathRequestId = PathService->Auth_RequestPath(InstanceData.Controller, InstanceData.Destination, FShooterPathReadyDelegate::CreateLambda(
+		[WeakContext = Context.MakeWeakExecutionContext()](FNavPathSharedPtr Path)
+		{
+			// get the instance data inside the lambda
+			FInstanceDataType* LambdaInstanceData = WeakContext.MakeStrongExecutionContext().GetInstanceDataPtr<FInstanceDataType>();
+
+			if (!LambdaInstanceData)
+			{
+				return;
+			}
+
+			LambdaInstanceData->PathRequestId = 0;
+
+			if (!Path.IsValid())
+			{
+				LambdaInstanceData->bPathFailed = true;
+				return;
+			}
+
+			// follow the path we were given instead of searching again
+			FAIMoveRequest MoveRequest(LambdaInstanceData->Destination);
+			MoveRequest.SetAcceptanceRadius(LambdaInstanceData->AcceptanceRadius);
+
+			LambdaInstanceData->bMoving = LambdaInstanceData->Controller->RequestMove(MoveRequest, Path).IsValid();
+			LambdaInstanceData->bPathFailed = !LambdaInstanceData->bMoving;
+		}
+	));
+
+	return EStateTreeRunStatus::Running;
+}
+
+EStateTreeRunStatus FStateTreeShooterMoveToTask::Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const
+{
+	// get the instance data
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	if (InstanceData.bPathFailed)
+	{
+		return EStateTreeRunStatus::Failed;
+	}
+
+	// still waiting on the path service
+	if (!InstanceData.bMoving)
+	{
+		return EStateTreeRunStatus::Running;
+	}
+
+	if (InstanceData.Controller->GetMoveStatus() != EPathFollowingStatus::Idle)
+	{
+		return EStateTreeRunStatus::Running;
+	}
+
+	// the move is over, did we make it?
+	InstanceData.bMoving = false;
+
+	const APawn* Pawn = InstanceData.Controller->GetPawn();
+	const bool bArrived = Pawn && FVector::Dist2D(Pawn->GetActorLocation(), InstanceData.Destination) <= InstanceData.AcceptanceRadius + Pawn->GetSimpleCollisionRadius();
+
+	return bArrived ? EStateTreeRunStatus::Succeeded : EStateTreeRunStatus::Failed;
+}
+
+void FStateTreeShooterMoveToTask::ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
+{
+	// get the instance data
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	// drop the path request if it's still in flight
+	if (InstanceData.PathRequestId != 0)
+	{
+		if (UShooterPathSubsystem* PathService = InstanceData.Controller->GetWorld()->GetSubsystem<UShooterPathSubsystem>())
+		{
+			PathService->Auth_CancelRequest(InstanceData.PathRequestId);
+		}
+
+		InstanceData.PathRequestId = 0;
+	}
+
+	// stop if we were interrupted on the way
+	if (InstanceData.bMoving)
+	{
+		InstanceData.Controller->StopMovement();
+		InstanceData.bMoving = false;
+	}
+}
+
+#if WITH_EDITOR
+FText FStateTreeShooterMoveToTask::GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting /*= EStateTreeNodeFormatting::Text*/) const
+{
+	return FText::FromString("<b>Move To Location</b>");
 }
 #endif // WITH_EDITOR
\ No newline at end of file
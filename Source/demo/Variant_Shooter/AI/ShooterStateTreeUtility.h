@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include "StateTreeTaskBase.h"
 #include "StateTreeConditionBase.h"
+#include "ShooterInfluenceMapSubsystem.h"
 
 #include "ShooterStateTreeUtility.generated.h"
 
@@ -270,7 +271,7 @@ struct FStateTreeSenseEnemiesInstanceData
 	UPROPERTY(EditAnywhere, Category = Output)
 	bool bHasInvestigateLocation = false;
 
-	/** Tag required on sensed actors */
+	/** Tag required on sensed actors that aren't team agents. Team agents are sensed by attitude instead */
 	UPROPERTY(EditAnywhere, Category = Parameter)
 	FName SenseTag = FName("Player");
 
@@ -281,10 +282,16 @@ struct FStateTreeSenseEnemiesInstanceData
 	/** Strength of the last processed stimulus */
 	UPROPERTY(EditAnywhere)
 	float LastStimulusStrength = 0.0f;
+
+	/** True if the current target was shared by the squad instead of sensed directly */
+	UPROPERTY(EditAnywhere)
+	bool bTargetFromSquad = false;
 };
 
 /**
  *  StateTree task to have an NPC process AI Perceptions and sense nearby enemies
+ *  Perception events are queued on the controller and drained once per tick. Each actor is processed once
+ *  with its strongest stimulus, and line of sight is traced for the strongest candidates until one is visible
  */
 USTRUCT(meta=(DisplayName="Sense Enemies", Category="Shooter"))
 struct FStateTreeSenseEnemiesTask : public FStateTreeTaskCommonBase
@@ -298,6 +305,120 @@ struct FStateTreeSenseEnemiesTask : public FStateTreeTaskCommonBase
 	/** Runs when the owning state is entered */
 	virtual EStateTreeRunStatus EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
 
+	/** Runs while the owning state is active */
+	virtual EStateTreeRunStatus Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const override;
+
+#if WITH_EDITOR
+	virtual FText GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting = EStateTreeNodeFormatting::Text) const override;
+#endif // WITH_EDITOR
+};
+
+////////////////////////////////////////////////////////////////////
+
+/**
+ *  Instance data struct for the Query Influence Map StateTree task
+ */
+USTRUCT()
+struct FStateTreeQueryInfluenceMapInstanceData
+{
+	GENERATED_BODY()
+
+	/** Querying NPC */
+	UPROPERTY(EditAnywhere, Category = Context)
+	TObjectPtr<AShooterNPC> Character;
+
+	/** Center of the search, usually the NPC or its target */
+	UPROPERTY(EditAnywhere, Category = Input)
+	FVector Origin = FVector::ZeroVector;
+
+	/** Tactical question to ask */
+	UPROPERTY(EditAnywhere, Category = Parameter)
+	EShooterInfluenceQuery Query = EShooterInfluenceQuery::Retreat;
+
+	/** Max distance from the origin */
+	UPROPERTY(EditAnywhere, Category = Parameter, meta = (ClampMin = 0, Units = "cm"))
+	float SearchRadius = 2000.0f;
+
+	/** Navigable location that best answers the question */
+	UPROPERTY(EditAnywhere, Category = Output)
+	FVector OutLocation = FVector::ZeroVector;
+};
+
+/**
+ *  StateTree task to pick a retreat, flank or investigate location from the tactical influence map
+ *  Succeeds with a navigable location, or fails if no location qualifies
+ */
+USTRUCT(meta=(DisplayName="Query Influence Map", Category="Shooter"))
+struct FStateTreeQueryInfluenceMapTask : public FStateTreeTaskCommonBase
+{
+	GENERATED_BODY()
+
+	/* Ensure we're using the correct instance data struct */
+	using FInstanceDataType = FStateTreeQueryInfluenceMapInstanceData;
+	virtual const UStruct* GetInstanceDataType() const override { return FInstanceDataType::StaticStruct(); }
+
+	/** Runs when the owning state is entered */
+	virtual EStateTreeRunStatus EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
+
+#if WITH_EDITOR
+	virtual FText GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting = EStateTreeNodeFormatting::Text) const override;
+#endif // WITH_EDITOR
+};
+
+////////////////////////////////////////////////////////////////////
+
+/**
+ *  Instance data struct for the Move To Location StateTree task
+ */
+USTRUCT()
+struct FStateTreeShooterMoveToInstanceData
+{
+	GENERATED_BODY()
+
+	/** Moving AI Controller */
+	UPROPERTY(EditAnywhere, Category = Context)
+	TObjectPtr<AShooterAIController> Controller;
+
+	/** Location to move to */
+	UPROPERTY(EditAnywhere, Category = Input)
+	FVector Destination = FVector::ZeroVector;
+
+	/** Distance from the destination that counts as arrived */
+	UPROPERTY(EditAnywhere, Category = Parameter, meta = (ClampMin = 0, Units = "cm"))
+	float AcceptanceRadius = 100.0f;
+
+	/** Path service request in flight */
+	UPROPERTY()
+	uint32 PathRequestId = 0;
+
+	/** True once the path has been handed to the path following component */
+	UPROPERTY()
+	bool bMoving = false;
+
+	/** True if the path service couldn't find a path */
+	UPROPERTY()
+	bool bPathFailed = false;
+};
+
+/**
+ *  StateTree task to move an NPC to a location through the batched path service
+ *  Succeeds when the NPC arrives, fails if there's no path or the move is aborted
+ */
+USTRUCT(meta=(DisplayName="Move To Location", Category="Shooter"))
+struct FStateTreeShooterMoveToTask : public FStateTreeTaskCommonBase
+{
+	GENERATED_BODY()
+
+	/* Ensure we're using the correct instance data struct */
+	using FInstanceDataType = FStateTreeShooterMoveToInstanceData;
+	virtual const UStruct* GetInstanceDataType() const override { return FInstanceDataType::StaticStruct(); }
+
+	/** Runs when the owning state is entered */
+	virtual EStateTreeRunStatus EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
+
+	/** Runs while the owning state is active */
+	virtual EStateTreeRunStatus Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const override;
+
 	/** Runs when the owning state is ended */
 	virtual void ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
 
@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/AI/ShooterTeamSettings.h"
+
+ETeamAttitude::Type UShooterTeamSettings::GetAttitude(FGenericTeamId Of, FGenericTeamId Towards)
+{
+	// actors without a team don't take sides
+	if (Of == FGenericTeamId::NoTeam || Towards == FGenericTeamId::NoTeam)
+	{
+		return ETeamAttitude::Neutral;
+	}
+
+	// look up the table first
+	const UShooterTeamSettings* Settings = GetDefault<UShooterTeamSettings>();
+
+	if (Settings->TeamAttitudes.IsValidIndex(Of.GetId()))
+	{
+		const TArray<TEnumAsByte<ETeamAttitude::Type>>& Attitudes = Settings->TeamAttitudes[Of.GetId()].Attitudes;
+
+		if (Attitudes.IsValidIndex(Towards.GetId()))
+		{
+			return Attitudes[Towards.GetId()];
+		}
+	}
+
+	return Of == Towards ? ETeamAttitude::Friendly : ETeamAttitude::Hostile;
+}
+
+void UShooterTeamSettings::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	// perception asks the global solver about affiliation, so route it to our table
+	if (HasAnyFlags(RF_ClassDefaultObject))
+	{
+		FGenericTeamId::SetAttitudeSolver(&UShooterTeamSettings::GetAttitude);
+	}
+}
@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "GenericTeamAgentInterface.h"
+#include "ShooterTeamSettings.generated.h"
+
+/**
+ *  Attitudes of one team towards every other team
+ */
+USTRUCT()
+struct FShooterTeamAttitudeRow
+{
+	GENERATED_BODY()
+
+	/** Attitude towards each team, indexed by team ID */
+	UPROPERTY(EditAnywhere, Category="Teams")
+	TArray<TEnumAsByte<ETeamAttitude::Type>> Attitudes;
+};
+
+/**
+ *  Team attitude table used by AI perception and team checks
+ *  Teams are identified by the TeamByte set on characters and NPCs
+ *  Pairs missing from the table fall back to friendly within a team and hostile across teams
+ */
+UCLASS(config=Game, defaultconfig, meta = (DisplayName = "Shooter Teams"))
+class DEMO_API UShooterTeamSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Attitude rows, indexed by the team ID whose attitude they describe */
+	UPROPERTY(Config, EditAnywhere, Category="Teams")
+	TArray<FShooterTeamAttitudeRow> TeamAttitudes;
+
+public:
+
+	/** Returns the attitude of a team towards another team */
+	static ETeamAttitude::Type GetAttitude(FGenericTeamId Of, FGenericTeamId Towards);
+
+protected:
+
+	/** Installs the attitude solver once the defaults are loaded */
+	virtual void PostInitProperties() override;
+};
@@ -0,0 +1,350 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/AI/ShooterVisibilityGrid.h"
+#include "ShooterLineOfSightSubsystem.h"
+#include "Components/BoxComponent.h"
+#include "NavigationSystem.h"
+#include "Misc/Compression.h"
+#include "Misc/ScopedSlowTask.h"
+#include "Engine/World.h"
+#include "demo.h"
+
+AShooterVisibilityGrid::AShooterVisibilityGrid()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	// create the bake bounds
+	BakeBounds = CreateDefaultSubobject<UBoxComponent>(TEXT("Bake Bounds"));
+	SetRootComponent(BakeBounds);
+
+	BakeBounds->SetBoxExtent(FVector(5000.0f, 5000.0f, 1000.0f));
+	BakeBounds->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	BakeBounds->SetHiddenInGame(true);
+}
+
+bool AShooterVisibilityGrid::ArePotentiallyVisible(const FVector& From, const FVector& To) const
+{
+	const int32 FromRow = GetRow(From);
+	const int32 ToRow = GetRow(To);
+
+	// we know nothing about unbaked locations, so never reject them
+	if (FromRow == INDEX_NONE || ToRow == INDEX_NONE)
+	{
+		return true;
+	}
+
+	return (VisibilityWords[FromRow * RowStride + (ToRow >> 5)] & (1u << (ToRow & 31))) != 0;
+}
+
+void AShooterVisibilityGrid::BeginPlay()
+{
+	Super::BeginPlay();
+
+	DecompressBits();
+
+	// let the line of sight service reject pairs with us
+	if (UShooterLineOfSightSubsystem* LineOfSight = GetWorld()->GetSubsystem<UShooterLineOfSightSubsystem>())
+	{
+		LineOfSight->RegisterVisibilityGrid(this);
+	}
+}
+
+void AShooterVisibilityGrid::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UShooterLineOfSightSubsystem* LineOfSight = GetWorld()->GetSubsystem<UShooterLineOfSightSubsystem>())
+	{
+		LineOfSight->UnregisterVisibilityGrid(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+int32 AShooterVisibilityGrid::GetRow(const FVector& Location) const
+{
+	if (VisibilityWords.Num() == 0)
+	{
+		return INDEX_NONE;
+	}
+
+	const FVector Local = (Location - GridOrigin) / FVector(CellSize, CellSize, CellHeight);
+
+	const int32 X = FMath::FloorToInt(Local.X);
+	const int32 Y = FMath::FloorToInt(Local.Y);
+	const int32 Z = FMath::FloorToInt(Local.Z);
+
+	if (X < 0 || Y < 0 || Z < 0 || X >= GridSize.X || Y >= GridSize.Y || Z >= GridSize.Z)
+	{
+		return INDEX_NONE;
+	}
+
+	return CellToRow[(Z * GridSize.Y + Y) * GridSize.X + X];
+}
+
+void AShooterVisibilityGrid::DecompressBits()
+{
+	RowStride = FMath::DivideAndRoundUp(NumRows, 32);
+
+	VisibilityWords.Reset();
+
+	if (NumRows == 0 || CompressedBits.Num() == 0)
+	{
+		return;
+	}
+
+	VisibilityWords.SetNumUninitialized(NumRows * RowStride);
+
+	// with bad data we'd rather reject nothing than the wrong pairs
+	if (!FCompression::UncompressMemory(NAME_Zlib, VisibilityWords.GetData(), VisibilityWords.Num() * sizeof(uint32), CompressedBits.GetData(), CompressedBits.Num()))
+	{
+		UE_LOG(Logdemo, Error, TEXT("'%s' failed to decompress its visibility data. Rebake it."), *GetNameSafe(this));
+		VisibilityWords.Reset();
+	}
+}
+
+#if WITH_EDITOR
+
+void AShooterVisibilityGrid::BakeVisibility()
+{
+	UWorld* World = GetWorld();
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+
+	if (!NavSys)
+	{
+		UE_LOG(Logdemo, Error, TEXT("'%s' can't bake visibility without a navigation system."), *GetNameSafe(this));
+		return;
+	}
+
+	Modify();
+
+	// keep the previous bake around in case this one gets canceled
+	const FIntVector PreviousGridSize = GridSize;
+	const FVector PreviousGridOrigin = GridOrigin;
+	const TArray<int32> PreviousCellToRow = CellToRow;
+	const int32 PreviousNumRows = NumRows;
+
+	auto CancelBake = [&]()
+	{
+		GridSize = PreviousGridSize;
+		GridOrigin = PreviousGridOrigin;
+		CellToRow = PreviousCellToRow;
+		NumRows = PreviousNumRows;
+
+		DecompressBits();
+
+		UE_LOG(Logdemo, Warning, TEXT("'%s' visibility bake canceled. Kept the previous bake."), *GetNameSafe(this));
+	};
+
+	// half the progress goes to sampling the cells, the other half to tracing them
+	FScopedSlowTask SlowTask(2.0f, FText::FromString(TEXT("Baking visibility...")));
+	SlowTask.MakeDialog(true);
+
+	const FBox Box = BakeBounds->Bounds.GetBox();
+	const FVector CellExtent = FVector(CellSize, CellSize, CellHeight) * 0.5f;
+
+	GridOrigin = Box.Min;
+	GridSize = FIntVector(
+		FMath::Max(1, FMath::CeilToInt(Box.GetSize().X / CellSize)),
+		FMath::Max(1, FMath::CeilToInt(Box.GetSize().Y / CellSize)),
+		FMath::Max(1, FMath::CeilToInt(Box.GetSize().Z / CellHeight)));
+
+	// sample the navmesh at the center and the quadrants of each cell
+	const FVector SampleOffsets[] = {
+		FVector::ZeroVector,
+		FVector(-0.25f, -0.25f, 0.0f) * CellSize,
+		FVector(0.25f, -0.25f, 0.0f) * CellSize,
+		FVector(-0.25f, 0.25f, 0.0f) * CellSize,
+		FVector(0.25f, 0.25f, 0.0f) * CellSize
+	};
+
+	const int32 NumSampleOffsets = FMath::Min(SamplesPerCell, static_cast<int32>(UE_ARRAY_COUNT(SampleOffsets)));
+
+	TArray<TArray<FVector, TInlineAllocator<16>>> RowSamples;
+	TArray<FVector> RowCenters;
+	TArray<FIntVector> RowCells;
+
+	CellToRow.Init(INDEX_NONE, GridSize.X * GridSize.Y * GridSize.Z);
+
+	for (int32 Z = 0; Z < GridSize.Z; ++Z)
+	{
+		SlowTask.EnterProgressFrame(1.0f / GridSize.Z);
+
+		if (SlowTask.ShouldCancel())
+		{
+			CancelBake();
+			return;
+		}
+
+		for (int32 Y = 0; Y < GridSize.Y; ++Y)
+		{
+			for (int32 X = 0; X < GridSize.X; ++X)
+			{
+				const FVector CellCenter = GridOrigin + FVector(X + 0.5f, Y + 0.5f, Z + 0.5f) * FVector(CellSize, CellSize, CellHeight);
+				const FBox CellBox(CellCenter - CellExtent, CellCenter + CellExtent);
+
+				TArray<FVector, TInlineAllocator<16>> Samples;
+
+				for (int32 i = 0; i < NumSampleOffsets; ++i)
+				{
+					FNavLocation NavLocation;
+
+					// only keep navmesh that's actually inside this cell
+					if (NavSys->ProjectPointToNavigation(CellCenter + SampleOffsets[i], NavLocation, FVector(CellSize * 0.25f, CellSize * 0.25f, CellHeight * 0.5f)) && CellBox.IsInsideOrOn(NavLocation.Location))
+					{
+						Samples.Add(NavLocation.Location + FVector(0.0f, 0.0f, SampleHeight));
+					}
+				}
+
+				if (Samples.Num() > 0)
+				{
+					// characters aren't always standing on the navmesh, so also sample the cell volume
+					for (int32 SX = 0; SX < VolumeSamplesPerAxis; ++SX)
+					{
+						for (int32 SY = 0; SY < VolumeSamplesPerAxis; ++SY)
+						{
+							for (int32 SZ = 0; SZ < VolumeSamplesPerAxis; ++SZ)
+							{
+								const FVector Fraction = (FVector(SX, SY, SZ) + 0.5f) / VolumeSamplesPerAxis;
+								Samples.Add(CellBox.Min + Fraction * CellBox.GetSize());
+							}
+						}
+					}
+
+					CellToRow[(Z * GridSize.Y + Y) * GridSize.X + X] = RowSamples.Num();
+					RowSamples.Add(MoveTemp(Samples));
+					RowCenters.Add(CellCenter);
+					RowCells.Add(FIntVector(X, Y, Z));
+				}
+			}
+		}
+	}
+
+	NumRows = RowSamples.Num();
+	RowStride = FMath::DivideAndRoundUp(NumRows, 32);
+
+	VisibilityWords.Init(0, NumRows * RowStride);
+
+	auto SetVisible = [this](int32 A, int32 B)
+	{
+		VisibilityWords[A * RowStride + (B >> 5)] |= 1u << (B & 31);
+		VisibilityWords[B * RowStride + (A >> 5)] |= 1u << (A & 31);
+	};
+
+	// only static geometry blocks sight for good
+	const FCollisionObjectQueryParams ObjectParams(ECC_WorldStatic);
+	const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ShooterVisibilityBake), false, this);
+
+	const float MaxBakeDistanceSquared = FMath::Square(MaxBakeDistance);
+
+	for (int32 A = 0; A < NumRows; ++A)
+	{
+		SlowTask.EnterProgressFrame(1.0f / NumRows);
+
+		if (SlowTask.ShouldCancel())
+		{
+			CancelBake();
+			return;
+		}
+
+		SetVisible(A, A);
+
+		for (int32 B = A + 1; B < NumRows; ++B)
+		{
+			// too far to be worth tracing, so never reject
+			if (FVector::DistSquared(RowCenters[A], RowCenters[B]) > MaxBakeDistanceSquared)
+			{
+				SetVisible(A, B);
+				continue;
+			}
+
+			// one clear sightline between any two samples is enough
+			bool bVisible = false;
+
+			for (int32 i = 0; i < RowSamples[A].Num() && !bVisible; ++i)
+			{
+				for (int32 j = 0; j < RowSamples[B].Num() && !bVisible; ++j)
+				{
+					bVisible = !World->LineTraceTestByObjectType(RowSamples[A][i], RowSamples[B][j], ObjectParams, QueryParams);
+				}
+			}
+
+			if (bVisible)
+			{
+				SetVisible(A, B);
+			}
+		}
+	}
+
+	// let each cell see what its neighbors see, so sightlines between samples aren't missed
+	if (DilationCells > 0)
+	{
+		const TArray<uint32> BakedWords = VisibilityWords;
+
+		for (int32 A = 0; A < NumRows; ++A)
+		{
+			const FIntVector& Cell = RowCells[A];
+
+			for (int32 DZ = -DilationCells; DZ <= DilationCells; ++DZ)
+			{
+				for (int32 DY = -DilationCells; DY <= DilationCells; ++DY)
+				{
+					for (int32 DX = -DilationCells; DX <= DilationCells; ++DX)
+					{
+						const FIntVector Neighbor = Cell + FIntVector(DX, DY, DZ);
+
+						if (Neighbor.X < 0 || Neighbor.Y < 0 || Neighbor.Z < 0 || Neighbor.X >= GridSize.X || Neighbor.Y >= GridSize.Y || Neighbor.Z >= GridSize.Z)
+						{
+							continue;
+						}
+
+						const int32 NeighborRow = CellToRow[(Neighbor.Z * GridSize.Y + Neighbor.Y) * GridSize.X + Neighbor.X];
+
+						if (NeighborRow == INDEX_NONE || NeighborRow == A)
+						{
+							continue;
+						}
+
+						for (int32 Word = 0; Word < RowStride; ++Word)
+						{
+							VisibilityWords[A * RowStride + Word] |= BakedWords[NeighborRow * RowStride + Word];
+						}
+					}
+				}
+			}
+		}
+
+		// keep the matrix symmetric
+		for (int32 A = 0; A < NumRows; ++A)
+		{
+			for (int32 B = A + 1; B < NumRows; ++B)
+			{
+				const bool bAB = (VisibilityWords[A * RowStride + (B >> 5)] & (1u << (B & 31))) != 0;
+				const bool bBA = (VisibilityWords[B * RowStride + (A >> 5)] & (1u << (A & 31))) != 0;
+
+				if (bAB || bBA)
+				{
+					SetVisible(A, B);
+				}
+			}
+		}
+	}
+
+	// compress the matrix for storage. Visibility is spatially coherent, so the rows compress well
+	const int32 UncompressedSize = VisibilityWords.Num() * sizeof(uint32);
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, UncompressedSize);
+
+	CompressedBits.SetNumUninitialized(CompressedSize);
+
+	if (!FCompression::CompressMemory(NAME_Zlib, CompressedBits.GetData(), CompressedSize, VisibilityWords.GetData(), UncompressedSize))
+	{
+		UE_LOG(Logdemo, Error, TEXT("'%s' failed to compress its visibility data."), *GetNameSafe(this));
+		CompressedBits.Reset();
+		return;
+	}
+
+	CompressedBits.SetNum(CompressedSize);
+
+	UE_LOG(Logdemo, Log, TEXT("'%s' baked visibility for %d cells into %d bytes."), *GetNameSafe(this), NumRows, CompressedBits.Num());
+}
+
+#endif
@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "ShooterVisibilityGrid.generated.h"
+
+class UBoxComponent;
+
+/**
+ *  Baked cell to cell potential visibility set for a part of the level
+ *  The bake bounds are split into coarse cells. Every pair of cells with navmesh in them is traced offline
+ *  from points on the navmesh and across the cell volume, then each cell also inherits what its neighbors see,
+ *  so the set errs on the side of visible. The results are kept as a compressed bit matrix saved with the map
+ *  At runtime, an observer and a target in mutually invisible cells can be rejected with a single bit test,
+ *  before any trace is run. Locations outside the baked cells are never rejected
+ */
+UCLASS()
+class DEMO_API AShooterVisibilityGrid : public AActor
+{
+	GENERATED_BODY()
+
+	/** Bounds of the baked area */
+	UPROPERTY(VisibleAnywhere, Category="Components", meta = (AllowPrivateAccess = "true"))
+	UBoxComponent* BakeBounds;
+
+protected:
+
+	/** Horizontal size of a cell */
+	UPROPERTY(EditAnywhere, Category="Visibility|Bake", meta = (ClampMin = 100, ClampMax = 5000, Units = "cm"))
+	float CellSize = 800.0f;
+
+	/** Vertical size of a cell */
+	UPROPERTY(EditAnywhere, Category="Visibility|Bake", meta = (ClampMin = 100, ClampMax = 5000, Units = "cm"))
+	float CellHeight = 400.0f;
+
+	/** Height above the navmesh of the sample points. Roughly a standing character's eyes */
+	UPROPERTY(EditAnywhere, Category="Visibility|Bake", meta = (ClampMin = 0, ClampMax = 300, Units = "cm"))
+	float SampleHeight = 150.0f;
+
+	/** Number of navmesh samples per cell. More samples make the set less likely to miss narrow sightlines */
+	UPROPERTY(EditAnywhere, Category="Visibility|Bake", meta = (ClampMin = 1, ClampMax = 5))
+	int32 SamplesPerCell = 5;
+
+	/** Number of samples along each axis of the cell volume, on top of the navmesh samples. Covers ledges, jumps and crouching */
+	UPROPERTY(EditAnywhere, Category="Visibility|Bake", meta = (ClampMin = 0, ClampMax = 4))
+	int32 VolumeSamplesPerAxis = 2;
+
+	/** Number of neighboring cells whose visibility each cell inherits, to cover sightlines the samples missed */
+	UPROPERTY(EditAnywhere, Category="Visibility|Bake", meta = (ClampMin = 0, ClampMax = 2))
+	int32 DilationCells = 1;
+
+	/** Pairs of cells further apart than this aren't traced and are never rejected */
+	UPROPERTY(EditAnywhere, Category="Visibility|Bake", meta = (ClampMin = 1000, Units = "cm"))
+	float MaxBakeDistance = 15000.0f;
+
+	/** Number of cells along each axis */
+	UPROPERTY()
+	FIntVector GridSize = FIntVector::ZeroValue;
+
+	/** World location of the grid's min corner */
+	UPROPERTY()
+	FVector GridOrigin = FVector::ZeroVector;
+
+	/** Index into the bit matrix for each cell, or INDEX_NONE for cells with no navmesh */
+	UPROPERTY()
+	TArray<int32> CellToRow;
+
+	/** Number of cells in the bit matrix */
+	UPROPERTY()
+	int32 NumRows = 0;
+
+	/** Zlib compressed bit matrix */
+	UPROPERTY()
+	TArray<uint8> CompressedBits;
+
+	/** Bit matrix, one row of words per baked cell */
+	TArray<uint32> VisibilityWords;
+
+	/** Number of words in each row */
+	int32 RowStride = 0;
+
+public:
+
+	/** Constructor */
+	AShooterVisibilityGrid();
+
+	/** Returns false only if both locations are in baked cells that can't see each other */
+	bool ArePotentiallyVisible(const FVector& From, const FVector& To) const;
+
+#if WITH_EDITOR
+
+	/** Traces every pair of cells inside the bake bounds and stores the results */
+	UFUNCTION(CallInEditor, Category="Visibility")
+	void BakeVisibility();
+
+#endif
+
+protected:
+
+	//~Begin AActor interface
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	//~End AActor interface
+
+	/** Returns the bit matrix row for a location, or INDEX_NONE */
+	int32 GetRow(const FVector& Location) const;
+
+	/** Inflates the compressed bits */
+	void DecompressBits();
+};
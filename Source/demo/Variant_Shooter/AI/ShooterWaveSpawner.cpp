@@ -0,0 +1,136 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/AI/ShooterWaveSpawner.h"
+#include "ShooterNPCPoolSubsystem.h"
+#include "ShooterNPC.h"
+#include "NavigationSystem.h"
+#include "Components/SceneComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
+
+AShooterWaveSpawner::AShooterWaveSpawner()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	// create the root
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+}
+
+void AShooterWaveSpawner::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// waves are run by the server
+	if (!HasAuthority() || !NPCClass)
+	{
+		return;
+	}
+
+	// fill the pool while the level is still quiet
+	if (bPrewarmPool)
+	{
+		if (UShooterNPCPoolSubsystem* Pool = GetWorld()->GetSubsystem<UShooterNPCPoolSubsystem>())
+		{
+			Pool->Auth_Prewarm(NPCClass, GetActorTransform(), WaveSize);
+		}
+	}
+
+	GetWorld()->GetTimerManager().SetTimer(WaveTimer, this, &AShooterWaveSpawner::Auth_StartWave, FMath::Max(FirstWaveDelay, KINDA_SMALL_NUMBER), false);
+}
+
+void AShooterWaveSpawner::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Super::EndPlay(EndPlayReason);
+
+	// clear the wave timer
+	GetWorld()->GetTimerManager().ClearTimer(WaveTimer);
+}
+
+void AShooterWaveSpawner::Auth_StartWave()
+{
+	if (!HasAuthority() || !NPCClass)
+	{
+		return;
+	}
+
+	UShooterNPCPoolSubsystem* Pool = GetWorld()->GetSubsystem<UShooterNPCPoolSubsystem>();
+
+	if (!Pool)
+	{
+		return;
+	}
+
+	GetWorld()->GetTimerManager().ClearTimer(WaveTimer);
+
+	++WaveIndex;
+
+	// each wave gets its own layout
+	FRandomStream Stream(HashCombine(GetTypeHash(GetActorLocation()), GetTypeHash(WaveIndex)));
+
+	for (int32 i = 0; i < WaveSize; ++i)
+	{
+		++PendingSpawns;
+
+		Pool->Auth_QueueSpawn(NPCClass, GetSpawnTransform(Stream), FShooterNPCSpawnedDelegate::CreateUObject(this, &AShooterWaveSpawner::OnWaveNPCSpawned));
+	}
+}
+
+void AShooterWaveSpawner::OnWaveNPCSpawned(AShooterNPC* NPC)
+{
+	--PendingSpawns;
+
+	if (NPC)
+	{
+		++AliveNPCs;
+
+		NPC->OnPawnDeath.AddDynamic(this, &AShooterWaveSpawner::OnWaveNPCDied);
+	}
+
+	CheckWaveCleared();
+}
+
+void AShooterWaveSpawner::OnWaveNPCDied()
+{
+	--AliveNPCs;
+
+	CheckWaveCleared();
+}
+
+void AShooterWaveSpawner::CheckWaveCleared()
+{
+	// wait until the whole wave has spawned and died
+	if (PendingSpawns > 0 || AliveNPCs > 0)
+	{
+		return;
+	}
+
+	if (NumWaves > 0 && WaveIndex >= NumWaves)
+	{
+		return;
+	}
+
+	GetWorld()->GetTimerManager().SetTimer(WaveTimer, this, &AShooterWaveSpawner::Auth_StartWave, FMath::Max(TimeBetweenWaves, KINDA_SMALL_NUMBER), false);
+}
+
+FTransform AShooterWaveSpawner::GetSpawnTransform(FRandomStream& Stream) const
+{
+	const FVector2D Offset = FVector2D(Stream.VRand()).GetSafeNormal() * SpawnRadius * FMath::Sqrt(Stream.FRand());
+	const FRotator Facing(0.0f, Stream.FRandRange(-180.0f, 180.0f), 0.0f);
+
+	FVector Location = GetActorLocation() + FVector(Offset, 0.0f);
+
+	// snap to the navmesh and lift the capsule off the floor
+	if (const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld()))
+	{
+		FNavLocation NavLocation;
+
+		if (NavSys->ProjectPointToNavigation(Location, NavLocation))
+		{
+			Location = NavLocation.Location + FVector(0.0f, 0.0f, NPCClass->GetDefaultObject<AShooterNPC>()->GetCapsuleComponent()->GetScaledCapsuleHalfHeight());
+		}
+	}
+
+	return FTransform(Facing, Location);
+}
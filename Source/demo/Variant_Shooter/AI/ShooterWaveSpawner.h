@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "ShooterWaveSpawner.generated.h"
+
+class AShooterNPC;
+
+/**
+ *  Spawns waves of NPCs around itself through the NPC pool
+ *  The pool is prewarmed with a wave's worth of NPCs, and each wave is spread over several frames by the pool's spawn budget
+ *  The next wave starts a while after every NPC of the current one has died
+ */
+UCLASS()
+class DEMO_API AShooterWaveSpawner : public AActor
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** NPC class to spawn */
+	UPROPERTY(EditAnywhere, Category="Waves")
+	TSubclassOf<AShooterNPC> NPCClass;
+
+	/** Number of NPCs per wave */
+	UPROPERTY(EditAnywhere, Category="Waves", meta = (ClampMin = 1, ClampMax = 200))
+	int32 WaveSize = 20;
+
+	/** Number of waves to spawn. Zero keeps spawning waves forever */
+	UPROPERTY(EditAnywhere, Category="Waves", meta = (ClampMin = 0))
+	int32 NumWaves = 3;
+
+	/** Time to wait before the first wave */
+	UPROPERTY(EditAnywhere, Category="Waves", meta = (ClampMin = 0, ClampMax = 600, Units = "s"))
+	float FirstWaveDelay = 2.0f;
+
+	/** Time to wait after a wave is cleared before the next one */
+	UPROPERTY(EditAnywhere, Category="Waves", meta = (ClampMin = 0, ClampMax = 600, Units = "s"))
+	float TimeBetweenWaves = 10.0f;
+
+	/** Radius around the spawner the NPCs are placed in */
+	UPROPERTY(EditAnywhere, Category="Waves", meta = (ClampMin = 0, ClampMax = 100000, Units = "cm"))
+	float SpawnRadius = 1500.0f;
+
+	/** If true, a wave's worth of NPCs is spawned into the pool ahead of the first wave */
+	UPROPERTY(EditAnywhere, Category="Waves")
+	bool bPrewarmPool = true;
+
+	/** Number of waves started so far */
+	int32 WaveIndex = 0;
+
+	/** Number of spawns queued in the pool and not completed yet */
+	int32 PendingSpawns = 0;
+
+	/** Number of NPCs of the current wave still alive */
+	int32 AliveNPCs = 0;
+
+	/** Timer for the next wave */
+	FTimerHandle WaveTimer;
+
+public:
+
+	/** Constructor */
+	AShooterWaveSpawner();
+
+protected:
+
+	/** Prewarms the pool and schedules the first wave on the server */
+	virtual void BeginPlay() override;
+
+	/** Gameplay cleanup */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+
+	/** Starts the next wave */
+	UFUNCTION(BlueprintCallable, Category="Waves")
+	void Auth_StartWave();
+
+protected:
+
+	/** Called by the pool when a wave NPC has spawned */
+	void OnWaveNPCSpawned(AShooterNPC* NPC);
+
+	/** Called when a wave NPC dies */
+	UFUNCTION()
+	void OnWaveNPCDied();
+
+	/** Schedules the next wave once the current one is cleared */
+	void CheckWaveCleared();
+
+	/** Returns a spawn transform on the navmesh around the spawner */
+	FTransform GetSpawnTransform(FRandomStream& Stream) const;
+};
@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTypes.h"
+#include "ShooterCrowdFragments.generated.h"
+
+/**
+ *  Combat state a crowd NPC keeps while it's simulated as a Mass entity
+ */
+USTRUCT()
+struct DEMO_API FShooterCrowdCombatFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	/** Current HP */
+	float HP = 100.0f;
+
+	/** HP the NPC started with */
+	float MaxHP = 100.0f;
+
+	/** Team byte */
+	uint8 Team = 1;
+
+	/** Index of the weapon class in the crowd subsystem's weapon table */
+	uint8 WeaponId = 0;
+};
+
+/**
+ *  Simplified movement state for a crowd NPC simulated as a Mass entity
+ */
+USTRUCT()
+struct DEMO_API FShooterCrowdAgentFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	/** Index of the NPC class in the crowd subsystem's NPC table, used when promoting to an actor */
+	uint8 NPCClassId = 0;
+
+	/** Location the agent wanders around */
+	FVector HomeLocation = FVector::ZeroVector;
+
+	/** Location the agent is walking to */
+	FVector Destination = FVector::ZeroVector;
+
+	/** Max distance from home when picking a new destination */
+	float WanderRadius = 1500.0f;
+
+	/** Walking speed */
+	float Speed = 200.0f;
+
+	/** Height of the entity's location above the navmesh, so it lines up with the NPC's capsule center */
+	float HalfHeight = 0.0f;
+
+	/** Time to wait before picking a new destination */
+	float WaitTime = 0.0f;
+
+	/** Seed for the agent's destination picks */
+	int32 RandomSeed = 0;
+};
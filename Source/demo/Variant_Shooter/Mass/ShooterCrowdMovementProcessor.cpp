@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/Mass/ShooterCrowdMovementProcessor.h"
+#include "ShooterCrowdFragments.h"
+#include "MassCommonFragments.h"
+#include "MassExecutionContext.h"
+#include "MassCommonTypes.h"
+#include "NavigationSystem.h"
+#include "AI/NavigationSystemBase.h"
+
+UShooterCrowdMovementProcessor::UShooterCrowdMovementProcessor()
+	: EntityQuery(*this)
+{
+	// crowd NPCs only exist on the server
+	ExecutionFlags = static_cast<int32>(EProcessorExecutionFlags::Server | EProcessorExecutionFlags::Standalone);
+	ExecutionOrder.ExecuteInGroup = UE::Mass::ProcessorGroupNames::Movement;
+	bAutoRegisterWithProcessingPhases = true;
+
+	// destinations are picked with navmesh queries
+	bRequiresGameThreadExecution = true;
+}
+
+void UShooterCrowdMovementProcessor::ConfigureQueries(const TSharedRef<FMassEntityManager>& EntityManager)
+{
+	EntityQuery.AddRequirement<FTransformFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddRequirement<FShooterCrowdAgentFragment>(EMassFragmentAccess::ReadWrite);
+}
+
+void UShooterCrowdMovementProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(EntityManager.GetWorld());
+	const ANavigationData* NavData = NavSys ? NavSys->GetDefaultNavDataInstance() : nullptr;
+
+	EntityQuery.ForEachEntityChunk(Context, [this, NavSys, NavData](FMassExecutionContext& Context)
+	{
+		const TArrayView<FTransformFragment> Transforms = Context.GetMutableFragmentView<FTransformFragment>();
+		const TArrayView<FShooterCrowdAgentFragment> Agents = Context.GetMutableFragmentView<FShooterCrowdAgentFragment>();
+
+		const float DeltaTime = Context.GetDeltaTimeSeconds();
+
+		for (int32 i = 0; i < Context.GetNumEntities(); ++i)
+		{
+			FTransform& Transform = Transforms[i].GetMutableTransform();
+			FShooterCrowdAgentFragment& Agent = Agents[i];
+
+			// wait around for a bit at each destination
+			if (Agent.WaitTime > 0.0f)
+			{
+				Agent.WaitTime -= DeltaTime;
+				continue;
+			}
+
+			const FVector Location = Transform.GetLocation();
+			FVector ToDestination = Agent.Destination - Location;
+			ToDestination.Z = 0.0f;
+
+			const float Distance = ToDestination.Size();
+
+			if (Distance < AcceptanceRadius)
+			{
+				// pick the next destination around home. The seeded stream keeps agents out of step with each other
+				FRandomStream Stream(Agent.RandomSeed);
+				Agent.RandomSeed = Stream.RandHelper(MAX_int32);
+
+				const FVector2D Offset = FVector2D(Stream.VRand()).GetSafeNormal() * Stream.FRandRange(0.0f, Agent.WanderRadius);
+				const FVector HeightOffset(0.0f, 0.0f, Agent.HalfHeight);
+				const FVector Candidate = Agent.HomeLocation + FVector(Offset, 0.0f) - HeightOffset;
+
+				// stay put if there's no navmesh to walk on
+				Agent.Destination = Location;
+				Agent.WaitTime = Stream.FRandRange(MinWaitTime, MaxWaitTime);
+
+				FNavLocation NavLocation;
+
+				if (NavData && NavSys->ProjectPointToNavigation(Candidate, NavLocation, FVector(AcceptanceRadius, AcceptanceRadius, NavProjectionHeight), NavData))
+				{
+					// stop short of anything blocking the straight walk there
+					FVector HitLocation;
+					const FVector Goal = NavData->Raycast(Location - HeightOffset, NavLocation.Location, HitLocation, nullptr) ? HitLocation : NavLocation.Location;
+
+					Agent.Destination = Goal + HeightOffset;
+				}
+
+				continue;
+			}
+
+			// walk straight towards the destination, following the navmesh height and facing the way we move
+			const FVector Direction = ToDestination / Distance;
+			const float Step = FMath::Min(Agent.Speed * DeltaTime, Distance);
+			const float DeltaZ = (Agent.Destination.Z - Location.Z) * (Step / Distance);
+
+			Transform.SetLocation(Location + Direction * Step + FVector(0.0f, 0.0f, DeltaZ));
+			Transform.SetRotation(Direction.ToOrientationQuat());
+		}
+	});
+}
@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassProcessor.h"
+#include "MassEntityQuery.h"
+#include "ShooterCrowdMovementProcessor.generated.h"
+
+/**
+ *  Moves crowd NPC entities around their home location
+ *  Destinations are projected onto the navmesh and clipped with a navmesh raycast, so entities
+ *  walk in a straight line over walkable ground, with a short wait at each destination.
+ *  Entities are only simulated away from players, so there's no collision or pathfinding
+ */
+UCLASS()
+class DEMO_API UShooterCrowdMovementProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+
+	/** Crowd entities with a transform */
+	FMassEntityQuery EntityQuery;
+
+	/** Min time to wait at each destination */
+	UPROPERTY(EditAnywhere, Category="Crowd", meta = (ClampMin = 0, ClampMax = 30, Units = "s"))
+	float MinWaitTime = 2.0f;
+
+	/** Max time to wait at each destination */
+	UPROPERTY(EditAnywhere, Category="Crowd", meta = (ClampMin = 0, ClampMax = 30, Units = "s"))
+	float MaxWaitTime = 6.0f;
+
+	/** Distance at which a destination counts as reached */
+	UPROPERTY(EditAnywhere, Category="Crowd", meta = (ClampMin = 1, ClampMax = 500, Units = "cm"))
+	float AcceptanceRadius = 50.0f;
+
+	/** Vertical extent used when projecting destinations onto the navmesh */
+	UPROPERTY(EditAnywhere, Category="Crowd", meta = (ClampMin = 0, ClampMax = 2000, Units = "cm"))
+	float NavProjectionHeight = 300.0f;
+
+public:
+
+	/** Constructor */
+	UShooterCrowdMovementProcessor();
+
+protected:
+
+	//~Begin UMassProcessor interface
+	virtual void ConfigureQueries(const TSharedRef<FMassEntityManager>& EntityManager) override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+	//~End UMassProcessor interface
+};
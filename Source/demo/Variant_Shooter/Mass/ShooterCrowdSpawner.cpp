@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/Mass/ShooterCrowdSpawner.h"
+#include "ShooterCrowdSubsystem.h"
+#include "ShooterNPC.h"
+#include "Components/SceneComponent.h"
+#include "Engine/World.h"
+
+AShooterCrowdSpawner::AShooterCrowdSpawner()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	// create the root
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+}
+
+void AShooterCrowdSpawner::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// crowds are server-only, clients see the NPCs once they're promoted to replicated actors
+	if (!HasAuthority() || !NPCClass)
+	{
+		return;
+	}
+
+	UShooterCrowdSubsystem* Crowd = GetWorld()->GetSubsystem<UShooterCrowdSubsystem>();
+
+	if (!Crowd)
+	{
+		return;
+	}
+
+	// scatter the NPCs on the spawner's plane
+	FRandomStream Stream(GetTypeHash(GetActorLocation()));
+
+	for (int32 i = 0; i < NumNPCs; ++i)
+	{
+		const FVector2D Offset = FVector2D(Stream.VRand()).GetSafeNormal() * SpawnRadius * FMath::Sqrt(Stream.FRand());
+		const FRotator Facing(0.0f, Stream.FRandRange(-180.0f, 180.0f), 0.0f);
+
+		Crowd->Auth_AddCrowdNPC(NPCClass, FTransform(Facing, GetActorLocation() + FVector(Offset, 0.0f)), WanderRadius, WalkSpeed, TeamByte);
+	}
+}
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "ShooterCrowdSpawner.generated.h"
+
+class AShooterNPC;
+
+/**
+ *  Places a crowd of NPCs around itself as lightweight Mass entities
+ *  They're promoted to full NPC actors by the crowd subsystem when a player comes close
+ */
+UCLASS()
+class DEMO_API AShooterCrowdSpawner : public AActor
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** NPC class the crowd is promoted to */
+	UPROPERTY(EditAnywhere, Category="Crowd")
+	TSubclassOf<AShooterNPC> NPCClass;
+
+	/** Number of NPCs to add */
+	UPROPERTY(EditAnywhere, Category="Crowd", meta = (ClampMin = 0, ClampMax = 2000))
+	int32 NumNPCs = 50;
+
+	/** Radius around the spawner the NPCs are placed in */
+	UPROPERTY(EditAnywhere, Category="Crowd", meta = (ClampMin = 0, ClampMax = 100000, Units = "cm"))
+	float SpawnRadius = 3000.0f;
+
+	/** Max distance each NPC wanders from where it was placed */
+	UPROPERTY(EditAnywhere, Category="Crowd", meta = (ClampMin = 0, ClampMax = 10000, Units = "cm"))
+	float WanderRadius = 1500.0f;
+
+	/** Walking speed while simulated as an entity */
+	UPROPERTY(EditAnywhere, Category="Crowd", meta = (ClampMin = 0, ClampMax = 1000, Units = "cm/s"))
+	float WalkSpeed = 200.0f;
+
+	/** Team byte for the NPCs */
+	UPROPERTY(EditAnywhere, Category="Crowd")
+	uint8 TeamByte = 1;
+
+public:
+
+	/** Constructor */
+	AShooterCrowdSpawner();
+
+protected:
+
+	/** Adds the crowd on the server */
+	virtual void BeginPlay() override;
+};
@@ -0,0 +1,287 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/Mass/ShooterCrowdSubsystem.h"
+#include "ShooterNPC.h"
+#include "ShooterAIController.h"
+#include "MassEntitySubsystem.h"
+#include "MassEntityManager.h"
+#include "MassCommonFragments.h"
+#include "GameFramework/PlayerController.h"
+#include "Components/CapsuleComponent.h"
+#include "NavigationSystem.h"
+#include "Engine/World.h"
+
+void UShooterCrowdSubsystem::Auth_AddCrowdNPC(TSubclassOf<AShooterNPC> NPCClass, const FTransform& Transform, float WanderRadius, float Speed, uint8 Team)
+{
+	FMassEntityManager* EntityManager = GetEntityManager();
+
+	if (!EntityManager || !NPCClass)
+	{
+		return;
+	}
+
+	// read the combat defaults off the NPC class
+	const AShooterNPC* NPCDefaults = NPCClass->GetDefaultObject<AShooterNPC>();
+
+	const float HalfHeight = NPCDefaults->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	const FTransform NavTransform = ProjectToNavigation(Transform, HalfHeight);
+
+	const FMassEntityHandle Entity = EntityManager->CreateEntity(CrowdArchetype);
+
+	EntityManager->GetFragmentDataChecked<FTransformFragment>(Entity).SetTransform(NavTransform);
+
+	FShooterCrowdCombatFragment& Combat = EntityManager->GetFragmentDataChecked<FShooterCrowdCombatFragment>(Entity);
+	Combat.HP = NPCDefaults->CurrentHP;
+	Combat.MaxHP = NPCDefaults->CurrentHP;
+	Combat.Team = Team;
+	Combat.WeaponId = GetClassId(WeaponClasses, NPCDefaults->GetWeaponClass());
+
+	FShooterCrowdAgentFragment& Agent = EntityManager->GetFragmentDataChecked<FShooterCrowdAgentFragment>(Entity);
+	Agent.NPCClassId = GetClassId(NPCClasses, NPCClass);
+	Agent.HomeLocation = NavTransform.GetLocation();
+	Agent.Destination = NavTransform.GetLocation();
+	Agent.WanderRadius = WanderRadius;
+	Agent.Speed = Speed;
+	Agent.HalfHeight = HalfHeight;
+	Agent.RandomSeed = static_cast<int32>(GetTypeHash(Entity));
+
+	CrowdEntities.Add(Entity);
+}
+
+bool UShooterCrowdSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterCrowdSubsystem::Tick(float DeltaTime)
+{
+	if (CrowdEntities.Num() == 0 && PromotedNPCs.Num() == 0)
+	{
+		return;
+	}
+
+	TimeUntilEvaluation -= DeltaTime;
+
+	if (TimeUntilEvaluation > 0.0f)
+	{
+		return;
+	}
+
+	TimeUntilEvaluation = EvaluationInterval;
+
+	FMassEntityManager* EntityManager = GetEntityManager();
+
+	if (!EntityManager)
+	{
+		return;
+	}
+
+	// gather the player locations once
+	TArray<FVector, TInlineAllocator<8>> PlayerLocations;
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const APawn* PlayerPawn = It->Get() ? It->Get()->GetPawn() : nullptr)
+		{
+			PlayerLocations.Add(PlayerPawn->GetActorLocation());
+		}
+	}
+
+	PromoteEntities(*EntityManager, PlayerLocations);
+	DemoteNPCs(*EntityManager, PlayerLocations);
+}
+
+TStatId UShooterCrowdSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterCrowdSubsystem, STATGROUP_Tickables);
+}
+
+FMassEntityManager* UShooterCrowdSubsystem::GetEntityManager()
+{
+	UMassEntitySubsystem* MassSubsystem = GetWorld()->GetSubsystem<UMassEntitySubsystem>();
+
+	if (!MassSubsystem)
+	{
+		return nullptr;
+	}
+
+	FMassEntityManager& EntityManager = MassSubsystem->GetMutableEntityManager();
+
+	// every crowd entity shares the same fragments
+	if (!CrowdArchetype.IsValid())
+	{
+		CrowdArchetype = EntityManager.CreateArchetype({
+			FTransformFragment::StaticStruct(),
+			FShooterCrowdCombatFragment::StaticStruct(),
+			FShooterCrowdAgentFragment::StaticStruct()
+		});
+	}
+
+	return &EntityManager;
+}
+
+void UShooterCrowdSubsystem::PromoteEntities(FMassEntityManager& EntityManager, const TArray<FVector, TInlineAllocator<8>>& PlayerLocations)
+{
+	const float PromoteDistanceSquared = FMath::Square(PromoteDistance);
+
+	int32 NumPromoted = 0;
+
+	for (int32 i = CrowdEntities.Num() - 1; i >= 0 && NumPromoted < MaxPromotionsPerFrame; --i)
+	{
+		const FMassEntityHandle Entity = CrowdEntities[i];
+
+		if (!EntityManager.IsEntityValid(Entity))
+		{
+			CrowdEntities.RemoveAtSwap(i, EAllowShrinking::No);
+			continue;
+		}
+
+		const FVector Location = EntityManager.GetFragmentDataChecked<FTransformFragment>(Entity).GetTransform().GetLocation();
+
+		if (GetNearestDistanceSquared(Location, PlayerLocations) > PromoteDistanceSquared)
+		{
+			continue;
+		}
+
+		// the entity lives on as the actor
+		if (SpawnNPCForEntity(EntityManager, Entity))
+		{
+			EntityManager.DestroyEntity(Entity);
+			CrowdEntities.RemoveAtSwap(i, EAllowShrinking::No);
+
+			++NumPromoted;
+		}
+	}
+}
+
+void UShooterCrowdSubsystem::DemoteNPCs(FMassEntityManager& EntityManager, const TArray<FVector, TInlineAllocator<8>>& PlayerLocations)
+{
+	const float DemoteDistanceSquared = FMath::Square(DemoteDistance);
+
+	int32 NumDemoted = 0;
+
+	for (int32 i = PromotedNPCs.Num() - 1; i >= 0 && NumDemoted < MaxDemotionsPerFrame; --i)
+	{
+		FPromotedNPC& Promoted = PromotedNPCs[i];
+		AShooterNPC* NPC = Promoted.NPC.Get();
+
+		// dead and destroyed NPCs are no longer part of the crowd
+		if (!IsValid(NPC) || NPC->IsDead())
+		{
+			PromotedNPCs.RemoveAtSwap(i, EAllowShrinking::No);
+			continue;
+		}
+
+		if (GetNearestDistanceSquared(NPC->GetActorLocation(), PlayerLocations) < DemoteDistanceSquared)
+		{
+			continue;
+		}
+
+		// NPCs chasing a target stay actors until they give up
+		const AShooterAIController* Controller = Cast<AShooterAIController>(NPC->GetController());
+
+		if (Controller && IsValid(Controller->GetCurrentTarget()))
+		{
+			continue;
+		}
+
+		// move the actor's state back into an entity
+		const FMassEntityHandle Entity = EntityManager.CreateEntity(CrowdArchetype);
+
+		EntityManager.GetFragmentDataChecked<FTransformFragment>(Entity).SetTransform(NPC->GetActorTransform());
+
+		FShooterCrowdCombatFragment& Combat = EntityManager.GetFragmentDataChecked<FShooterCrowdCombatFragment>(Entity);
+		Combat.HP = NPC->CurrentHP;
+		Combat.MaxHP = NPC->GetMaxHP();
+		Combat.Team = NPC->GetTeamByte();
+		Combat.WeaponId = GetClassId(WeaponClasses, NPC->GetWeaponClass());
+
+		FShooterCrowdAgentFragment& Agent = EntityManager.GetFragmentDataChecked<FShooterCrowdAgentFragment>(Entity);
+		Agent = Promoted.Agent;
+		Agent.Destination = NPC->GetActorLocation();
+
+		CrowdEntities.Add(Entity);
+
+		// the weapon and controller go away with the pawn
+		NPC->Destroy();
+
+		PromotedNPCs.RemoveAtSwap(i, EAllowShrinking::No);
+		++NumDemoted;
+	}
+}
+
+bool UShooterCrowdSubsystem::SpawnNPCForEntity(FMassEntityManager& EntityManager, FMassEntityHandle Entity)
+{
+	const FTransform& EntityTransform = EntityManager.GetFragmentDataChecked<FTransformFragment>(Entity).GetTransform();
+	const FShooterCrowdCombatFragment& Combat = EntityManager.GetFragmentDataChecked<FShooterCrowdCombatFragment>(Entity);
+	const FShooterCrowdAgentFragment& Agent = EntityManager.GetFragmentDataChecked<FShooterCrowdAgentFragment>(Entity);
+
+	if (!NPCClasses.IsValidIndex(Agent.NPCClassId))
+	{
+		return false;
+	}
+
+	// snap the spawn onto the navmesh so the capsule doesn't start in a wall or under the floor
+	const FTransform Transform = ProjectToNavigation(EntityTransform, Agent.HalfHeight);
+
+	// defer the spawn so the combat state is in place before BeginPlay
+	AShooterNPC* NPC = GetWorld()->SpawnActorDeferred<AShooterNPC>(NPCClasses[Agent.NPCClassId], Transform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn);
+
+	if (!NPC)
+	{
+		return false;
+	}
+
+	const TSubclassOf<AShooterWeapon> WeaponClass = WeaponClasses.IsValidIndex(Combat.WeaponId) ? WeaponClasses[Combat.WeaponId] : nullptr;
+	NPC->InitFromCrowd(Combat.HP, Combat.MaxHP, Combat.Team, WeaponClass);
+
+	NPC->FinishSpawning(Transform);
+
+	// make sure the NPC gets its brain even if the class only auto possesses placed NPCs
+	if (!NPC->GetController())
+	{
+		NPC->SpawnDefaultController();
+	}
+
+	FPromotedNPC& Promoted = PromotedNPCs.AddDefaulted_GetRef();
+	Promoted.NPC = NPC;
+	Promoted.Agent = Agent;
+
+	return true;
+}
+
+FTransform UShooterCrowdSubsystem::ProjectToNavigation(const FTransform& Transform, float HalfHeight) const
+{
+	const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+
+	if (!NavSys)
+	{
+		return Transform;
+	}
+
+	const FVector HeightOffset(0.0f, 0.0f, HalfHeight);
+	FNavLocation NavLocation;
+
+	if (!NavSys->ProjectPointToNavigation(Transform.GetLocation() - HeightOffset, NavLocation, FVector(NavProjectionRadius, NavProjectionRadius, 2.0f * HalfHeight + NavProjectionRadius)))
+	{
+		return Transform;
+	}
+
+	FTransform Projected = Transform;
+	Projected.SetLocation(NavLocation.Location + HeightOffset);
+
+	return Projected;
+}
+
+float UShooterCrowdSubsystem::GetNearestDistanceSquared(const FVector& Location, const TArray<FVector, TInlineAllocator<8>>& PlayerLocations)
+{
+	float NearestDistanceSquared = UE_BIG_NUMBER;
+
+	for (const FVector& PlayerLocation : PlayerLocations)
+	{
+		NearestDistanceSquared = FMath::Min(NearestDistanceSquared, static_cast<float>(FVector::DistSquared(Location, PlayerLocation)));
+	}
+
+	return NearestDistanceSquared;
+}
@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MassEntityTypes.h"
+#include "MassArchetypeTypes.h"
+#include "ShooterCrowdFragments.h"
+#include "ShooterCrowdSubsystem.generated.h"
+
+class AShooterNPC;
+class AShooterWeapon;
+struct FMassEntityManager;
+
+/**
+ *  Server-side manager for large NPC crowds
+ *  NPCs away from every player live as lightweight Mass entities with a transform, a simplified wander movement
+ *  and a small combat fragment. Entities close to a player are promoted to full AShooterNPC actors,
+ *  and idle actors that drift away from every player are demoted back to entities
+ */
+UCLASS(config=Game)
+class DEMO_API UShooterCrowdSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Tracks an actor promoted from an entity */
+	struct FPromotedNPC
+	{
+		/** Promoted actor */
+		TWeakObjectPtr<AShooterNPC> NPC;
+
+		/** Agent state to restore when the actor is demoted */
+		FShooterCrowdAgentFragment Agent;
+	};
+
+	/** Distance to the nearest player under which entities are promoted to actors */
+	UPROPERTY(Config)
+	float PromoteDistance = 5000.0f;
+
+	/** Distance to the nearest player above which idle actors are demoted to entities. Larger than the promote distance to avoid flip-flopping */
+	UPROPERTY(Config)
+	float DemoteDistance = 6500.0f;
+
+	/** Max number of entities promoted per frame, to spread out actor spawn costs */
+	UPROPERTY(Config)
+	int32 MaxPromotionsPerFrame = 2;
+
+	/** Max number of actors demoted per frame */
+	UPROPERTY(Config)
+	int32 MaxDemotionsPerFrame = 4;
+
+	/** Time between promotion checks */
+	UPROPERTY(Config)
+	float EvaluationInterval = 0.25f;
+
+	/** Horizontal search extent when snapping spawn locations onto the navmesh */
+	UPROPERTY(Config)
+	float NavProjectionRadius = 200.0f;
+
+	/** NPC classes used by crowd entities, indexed by the agent fragment */
+	UPROPERTY(Transient)
+	TArray<TSubclassOf<AShooterNPC>> NPCClasses;
+
+	/** Weapon classes used by crowd entities, indexed by the combat fragment */
+	UPROPERTY(Transient)
+	TArray<TSubclassOf<AShooterWeapon>> WeaponClasses;
+
+	/** Actors promoted from entities */
+	TArray<FPromotedNPC> PromotedNPCs;
+
+	/** Entities currently simulated by Mass */
+	TArray<FMassEntityHandle> CrowdEntities;
+
+	/** Archetype shared by all crowd entities */
+	FMassArchetypeHandle CrowdArchetype;
+
+	/** Time left until the next promotion check */
+	float TimeUntilEvaluation = 0.0f;
+
+public:
+
+	/**
+	 * @brief Adds a crowd NPC simulated as a Mass entity
+	 * @param NPCClass actor class to promote the NPC to
+	 * @param Transform starting transform. The location doubles as the NPC's home
+	 * @param WanderRadius max distance the NPC wanders from home
+	 * @param Speed walking speed while simulated as an entity
+	 * @param Team team byte
+	 */
+	void Auth_AddCrowdNPC(TSubclassOf<AShooterNPC> NPCClass, const FTransform& Transform, float WanderRadius, float Speed, uint8 Team);
+
+	/** Returns the number of NPCs currently simulated as entities */
+	int32 GetNumCrowdEntities() const { return CrowdEntities.Num(); }
+
+protected:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+
+	/** Returns the entity manager, creating the crowd archetype on first use */
+	FMassEntityManager* GetEntityManager();
+
+	/** Promotes entities close to players, within the frame's limit */
+	void PromoteEntities(FMassEntityManager& EntityManager, const TArray<FVector, TInlineAllocator<8>>& PlayerLocations);
+
+	/** Demotes idle actors far from every player, within the frame's limit */
+	void DemoteNPCs(FMassEntityManager& EntityManager, const TArray<FVector, TInlineAllocator<8>>& PlayerLocations);
+
+	/** Spawns the actor for an entity. Returns false if the actor couldn't be spawned */
+	bool SpawnNPCForEntity(FMassEntityManager& EntityManager, FMassEntityHandle Entity);
+
+	/** Snaps a capsule center transform onto the navmesh. Returns the transform unchanged if there's no navmesh nearby */
+	FTransform ProjectToNavigation(const FTransform& Transform, float HalfHeight) const;
+
+	/** Finds or adds a class to a lookup table and returns its index */
+	template<typename T>
+	static uint8 GetClassId(TArray<TSubclassOf<T>>& Table, TSubclassOf<T> Class)
+	{
+		const int32 Index = Table.AddUnique(Class);
+		check(Index <= MAX_uint8);
+		return static_cast<uint8>(Index);
+	}
+
+	/** Returns the squared distance to the nearest player location */
+	static float GetNearestDistanceSquared(const FVector& Location, const TArray<FVector, TInlineAllocator<8>>& PlayerLocations);
+};
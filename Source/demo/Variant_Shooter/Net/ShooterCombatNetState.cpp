@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/Net/ShooterCombatNetState.h"
+#include "Serialization/Archive.h"
+
+void FCombatNetState::SetHealth(float HP, float MaxHP)
+{
+	constexpr uint32 MaxHealthValue = (1 << HealthBits) - 1;
+
+	const float Fraction = MaxHP > 0.0f ? FMath::Clamp(HP / MaxHP, 0.0f, 1.0f) : 0.0f;
+
+	// quantize right away so damage below one step doesn't dirty the property.
+	// Any alive character keeps at least one step so it never reads as empty
+	uint32 PackedHealth = FMath::RoundToInt(Fraction * MaxHealthValue);
+
+	if (PackedHealth == 0 && Fraction > 0.0f)
+	{
+		PackedHealth = 1;
+	}
+
+	HealthFraction = static_cast<float>(PackedHealth) / MaxHealthValue;
+}
+
+void FCombatNetState::SetAmmo(int32 InBullets, int32 InMagazineSize)
+{
+	constexpr int32 MaxMagazineSize = (1 << MagazineSizeBits) - 1;
+
+	MagazineSize = static_cast<uint8>(FMath::Clamp(InMagazineSize, 0, MaxMagazineSize));
+	Bullets = static_cast<uint8>(FMath::Clamp(InBullets, 0, static_cast<int32>(MagazineSize)));
+}
+
+bool FCombatNetState::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	constexpr uint32 MaxHealthValue = (1 << HealthBits) - 1;
+
+	// health is sent as a fixed point fraction. It's already quantized by SetHealth
+	uint32 PackedHealth = Ar.IsSaving() ? FMath::RoundToInt(FMath::Clamp(HealthFraction, 0.0f, 1.0f) * MaxHealthValue) : 0;
+	Ar.SerializeBits(&PackedHealth, HealthBits);
+
+	// the magazine size tells the receiver how many bits the bullet count uses
+	uint32 PackedMagazineSize = MagazineSize;
+	Ar.SerializeBits(&PackedMagazineSize, MagazineSizeBits);
+
+	uint32 PackedBullets = Bullets;
+	const uint32 BulletBits = FMath::CeilLogTwo(PackedMagazineSize + 1);
+
+	if (BulletBits > 0)
+	{
+		Ar.SerializeBits(&PackedBullets, BulletBits);
+	}
+
+	uint8 bPackedDead = bIsDead;
+	uint8 bPackedFiring = bIsFiring;
+	Ar.SerializeBits(&bPackedDead, 1);
+	Ar.SerializeBits(&bPackedFiring, 1);
+
+	if (Ar.IsLoading())
+	{
+		HealthFraction = static_cast<float>(PackedHealth) / MaxHealthValue;
+		MagazineSize = static_cast<uint8>(PackedMagazineSize);
+		Bullets = static_cast<uint8>(FMath::Min(PackedBullets, PackedMagazineSize));
+		bIsDead = bPackedDead != 0;
+		bIsFiring = bPackedFiring != 0;
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+bool FCombatNetState::operator==(const FCombatNetState& Other) const
+{
+	return HealthFraction == Other.HealthFraction
+		&& MagazineSize == Other.MagazineSize
+		&& Bullets == Other.Bullets
+		&& bIsDead == Other.bIsDead
+		&& bIsFiring == Other.bIsFiring;
+}
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShooterCombatNetState.generated.h"
+
+/**
+ *  Packed combat state shared by player characters and NPCs
+ *  Replicates as a single property with a custom bit-packed NetSerialize:
+ *  health as a 10 bit fraction of max HP, ammo in as many bits as the magazine needs, plus dead and firing flags
+ */
+USTRUCT()
+struct DEMO_API FCombatNetState
+{
+	GENERATED_BODY()
+
+	/** Number of bits used for the health fraction */
+	static constexpr uint32 HealthBits = 10;
+
+	/** Number of bits used to send the magazine size. Weapons clamp their magazine to 100 */
+	static constexpr uint32 MagazineSizeBits = 7;
+
+	/** Remaining health as a fraction of max HP, quantized on the wire */
+	UPROPERTY()
+	float HealthFraction = 1.0f;
+
+	/** Size of the equipped weapon's magazine */
+	UPROPERTY()
+	uint8 MagazineSize = 0;
+
+	/** Bullets left in the equipped weapon's magazine */
+	UPROPERTY()
+	uint8 Bullets = 0;
+
+	/** If true, the character has died */
+	UPROPERTY()
+	bool bIsDead = false;
+
+	/** If true, the character is holding down the trigger */
+	UPROPERTY()
+	bool bIsFiring = false;
+
+	/** Sets the health fraction from an HP value */
+	void SetHealth(float HP, float MaxHP);
+
+	/** Returns the HP value for the passed max HP */
+	float GetHealth(float MaxHP) const { return HealthFraction * MaxHP; }
+
+	/** Sets the ammo values, clamping them to what fits on the wire */
+	void SetAmmo(int32 InBullets, int32 InMagazineSize);
+
+	/** Bit-packs the state */
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FCombatNetState& Other) const;
+	bool operator!=(const FCombatNetState& Other) const { return !(*this == Other); }
+};
+
+template<>
+struct TStructOpsTypeTraits<FCombatNetState> : public TStructOpsTypeTraitsBase2<FCombatNetState>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShooterDeathInfo.generated.h"
+
+/**
+ *  Replicated record of a character's death
+ *  Clients react to it when it replicates in, so connections that only see the character later still get the dead state
+ */
+USTRUCT(BlueprintType)
+struct DEMO_API FShooterDeathInfo
+{
+	GENERATED_BODY()
+
+	/** Server world time of death. Zero while alive */
+	UPROPERTY(BlueprintReadOnly, Category="Death")
+	float DeathTime = 0.0f;
+
+	/** Player ID of the killer, or INDEX_NONE if there was no player killer */
+	UPROPERTY(BlueprintReadOnly, Category="Death")
+	int32 KillerId = INDEX_NONE;
+
+	/** Returns true if this records a death */
+	bool IsDead() const { return DeathTime > 0.0f; }
+};
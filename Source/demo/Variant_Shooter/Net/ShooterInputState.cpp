@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/Net/ShooterInputState.h"
+#include "Serialization/Archive.h"
+
+bool FShooterInputState::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	Ar << Sequence;
+	Ar << SwitchCount;
+
+	uint8 bPackedFire = bFireHeld;
+	Ar.SerializeBits(&bPackedFire, 1);
+
+	if (Ar.IsLoading())
+	{
+		bFireHeld = bPackedFire != 0;
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShooterInputState.generated.h"
+
+/**
+ *  Compact snapshot of a player's weapon inputs, sent from the owning client to the server
+ *  The state is absolute rather than a list of events, so a lost or repeated update is healed by the next one
+ */
+USTRUCT()
+struct DEMO_API FShooterInputState
+{
+	GENERATED_BODY()
+
+	/** Incremented by the client every time the state changes. Wraps around */
+	UPROPERTY()
+	uint8 Sequence = 0;
+
+	/** Total number of weapon switch requests made by the client. Wraps around */
+	UPROPERTY()
+	uint8 SwitchCount = 0;
+
+	/** If true, the trigger is held down */
+	UPROPERTY()
+	bool bFireHeld = false;
+
+	/** Returns true if the passed sequence number is newer than this state's, accounting for wrap around */
+	bool IsOlderThan(uint8 OtherSequence) const { return static_cast<int8>(OtherSequence - Sequence) > 0; }
+
+	/** Packs the state into 17 bits */
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FShooterInputState> : public TStructOpsTypeTraitsBase2<FShooterInputState>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/Net/ShooterJoinReplicationSubsystem.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/NetConnection.h"
+#include "Engine/World.h"
+
+void UShooterJoinReplicationSubsystem::Auth_RegisterJoiningPlayer(APlayerController* PlayerController)
+{
+	// local players don't have a connection to protect
+	if (!bEnabled || !PlayerController || PlayerController->IsLocalController())
+	{
+		return;
+	}
+
+	FJoiningConnection& Joining = JoiningConnections.AddDefaulted_GetRef();
+	Joining.PlayerController = PlayerController;
+}
+
+bool UShooterJoinReplicationSubsystem::IsUnlockedFor(const AActor* RealViewer, EShooterJoinPriority Priority) const
+{
+	// the common case is nobody joining
+	if (JoiningConnections.Num() == 0)
+	{
+		return true;
+	}
+
+	for (const FJoiningConnection& Joining : JoiningConnections)
+	{
+		if (Joining.PlayerController.Get() == RealViewer)
+		{
+			return Priority <= Joining.UnlockedTier;
+		}
+	}
+
+	return true;
+}
+
+EShooterJoinPriority UShooterJoinReplicationSubsystem::GetPriorityByDistance(const AActor* Actor, const FVector& SrcLocation, EShooterJoinPriority NearPriority, EShooterJoinPriority FarPriority) const
+{
+	return FVector::DistSquared(SrcLocation, Actor->GetActorLocation()) < FMath::Square(NearbyDistance) ? NearPriority : FarPriority;
+}
+
+bool UShooterJoinReplicationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterJoinReplicationSubsystem::Tick(float DeltaTime)
+{
+	for (int32 i = JoiningConnections.Num() - 1; i >= 0; --i)
+	{
+		FJoiningConnection& Joining = JoiningConnections[i];
+
+		// drop connections that went away
+		UNetConnection* Connection = Joining.PlayerController.IsValid() ? Joining.PlayerController->GetNetConnection() : nullptr;
+
+		if (!Connection || Connection->GetConnectionState() == USOCK_Closed)
+		{
+			JoiningConnections.RemoveAtSwap(i, EAllowShrinking::No);
+			continue;
+		}
+
+		++Joining.FramesInTier;
+
+		// give the current tier some frames to go out
+		if (Joining.FramesInTier < MinFramesPerTier)
+		{
+			continue;
+		}
+
+		// wait for the send queue to drain under budget, unless we've been waiting too long
+		const bool bUnderBudget = Connection->QueuedBits <= QueuedBytesBudget * 8;
+
+		if (!bUnderBudget && Joining.FramesInTier < MaxFramesPerTier)
+		{
+			continue;
+		}
+
+		// the last tier has been unlocked, so this connection is done joining
+		if (Joining.UnlockedTier == EShooterJoinPriority::Deferred)
+		{
+			JoiningConnections.RemoveAtSwap(i, EAllowShrinking::No);
+			continue;
+		}
+
+		// unlock the next tier
+		Joining.UnlockedTier = static_cast<EShooterJoinPriority>(static_cast<uint8>(Joining.UnlockedTier) + 1);
+		Joining.FramesInTier = 0;
+	}
+}
+
+TStatId UShooterJoinReplicationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterJoinReplicationSubsystem, STATGROUP_Tickables);
+}
@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterJoinReplicationSubsystem.generated.h"
+
+class APlayerController;
+
+/**
+ *  Order in which actors are opened on a connection that joins a match in progress
+ */
+UENUM()
+enum class EShooterJoinPriority : uint8
+{
+	/** The joining player's own pawn */
+	Essential,
+
+	/** Characters and NPCs close to the joining player, and the weapons they hold */
+	Combat,
+
+	/** Every other character and NPC, and pickups close to the joining player */
+	World,
+
+	/** Distant pickups and cosmetic state such as projectiles in flight */
+	Deferred
+};
+
+/**
+ *  Spreads the initial replication of a late joiner over several frames
+ *  Each joining connection unlocks one priority tier at a time, once the previous tier has had a few frames
+ *  to go out and the connection's send queue is back under its byte budget
+ */
+UCLASS(config=Game)
+class DEMO_API UShooterJoinReplicationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Tracks a connection that's still receiving its initial state */
+	struct FJoiningConnection
+	{
+		/** Controller owning the connection */
+		TWeakObjectPtr<APlayerController> PlayerController;
+
+		/** Highest tier currently allowed to replicate */
+		EShooterJoinPriority UnlockedTier = EShooterJoinPriority::Essential;
+
+		/** Frames spent on the current tier */
+		int32 FramesInTier = 0;
+	};
+
+	/** If false, late joiners receive everything at once */
+	UPROPERTY(Config)
+	bool bEnabled = true;
+
+	/** Minimum number of frames before unlocking the next tier */
+	UPROPERTY(Config)
+	int32 MinFramesPerTier = 3;
+
+	/** Maximum number of frames to wait on a tier for the send queue to drain */
+	UPROPERTY(Config)
+	int32 MaxFramesPerTier = 30;
+
+	/** Bytes that may still be queued on the connection when unlocking the next tier */
+	UPROPERTY(Config)
+	int32 QueuedBytesBudget = 4096;
+
+	/** Distance from the joining player under which actors are opened early */
+	UPROPERTY(Config)
+	float NearbyDistance = 3000.0f;
+
+	/** Connections still receiving their initial state */
+	TArray<FJoiningConnection> JoiningConnections;
+
+public:
+
+	/** Starts staggering replication for a player that joined a match in progress */
+	void Auth_RegisterJoiningPlayer(APlayerController* PlayerController);
+
+	/**
+	 * @brief Checks whether an actor may replicate to a viewer yet. Called from IsNetRelevantFor
+	 * @param RealViewer actor owning the connection, usually a player controller
+	 * @param Priority join priority of the actor being considered
+	 * @return false if the viewer is still joining and hasn't unlocked the actor's tier
+	 */
+	bool IsUnlockedFor(const AActor* RealViewer, EShooterJoinPriority Priority) const;
+
+	/** Picks between two priorities depending on the actor's distance to the viewpoint */
+	EShooterJoinPriority GetPriorityByDistance(const AActor* Actor, const FVector& SrcLocation, EShooterJoinPriority NearPriority, EShooterJoinPriority FarPriority) const;
+
+protected:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+};
@@ -0,0 +1,284 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/Net/ShooterNetInterpolationComponent.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/GameStateBase.h"
+#include "Engine/World.h"
+#include "Net/UnrealNetwork.h"
+
+bool FShooterNetSnapshot::IsSameState(const FShooterNetSnapshot& Other) const
+{
+	return Yaw == Other.Yaw
+		&& AimYaw == Other.AimYaw
+		&& AimPitch == Other.AimPitch
+		&& Location.Equals(Other.Location, 0.5f)
+		&& Velocity.Equals(Other.Velocity, 0.5f);
+}
+
+bool FShooterNetSnapshot::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	Ar << ServerTime;
+
+	bool bLocationSuccess = true;
+	bool bVelocitySuccess = true;
+	Location.NetSerialize(Ar, Map, bLocationSuccess);
+	Velocity.NetSerialize(Ar, Map, bVelocitySuccess);
+
+	Ar << Yaw;
+	Ar << AimYaw;
+	Ar << AimPitch;
+	Ar << UpdateInterval;
+
+	bOutSuccess = bLocationSuccess && bVelocitySuccess && !Ar.IsError();
+	return true;
+}
+
+UShooterNetInterpolationComponent::UShooterNetInterpolationComponent()
+{
+	// only simulated proxies tick, to move the owner
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	PrimaryComponentTick.TickGroup = TG_PrePhysics;
+
+	SetIsReplicatedByDefault(true);
+}
+
+void UShooterNetInterpolationComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (!bEnabled)
+	{
+		return;
+	}
+
+	if (GetOwner()->HasAuthority())
+	{
+		// snapshots take over from the default movement replication
+		GetOwner()->SetReplicatingMovement(false);
+		Auth_CaptureSnapshot();
+
+	} else if (GetOwnerRole() == ROLE_SimulatedProxy) {
+
+		// the snapshots drive the owner, so the movement component only has to hold the velocity for animation
+		if (ACharacter* Character = GetCharacterOwner())
+		{
+			Character->GetCharacterMovement()->SetComponentTickEnabled(false);
+		}
+
+		SetComponentTickEnabled(true);
+	}
+}
+
+void UShooterNetInterpolationComponent::GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+	DOREPLIFETIME(UShooterNetInterpolationComponent, ServerSnapshot);
+}
+
+void UShooterNetInterpolationComponent::Auth_CaptureSnapshot()
+{
+	if (!bEnabled || !GetOwner()->HasAuthority())
+	{
+		return;
+	}
+
+	const APawn* Pawn = Cast<APawn>(GetOwner());
+	const FRotator AimRotation = Pawn ? Pawn->GetBaseAimRotation() : GetOwner()->GetActorRotation();
+
+	FShooterNetSnapshot NewSnapshot;
+	NewSnapshot.Location = GetOwner()->GetActorLocation();
+	NewSnapshot.Velocity = GetOwner()->GetVelocity();
+	NewSnapshot.Yaw = FRotator::CompressAxisToShort(GetOwner()->GetActorRotation().Yaw);
+	NewSnapshot.AimYaw = FRotator::CompressAxisToShort(AimRotation.Yaw);
+	NewSnapshot.AimPitch = FRotator::CompressAxisToShort(AimRotation.Pitch);
+
+	// leave the snapshot untouched while nothing changed, so idle owners stop sending it
+	if (NewSnapshot.IsSameState(ServerSnapshot))
+	{
+		return;
+	}
+
+	// let proxies size their interpolation delay to our current update rate
+	const float NetUpdateInterval = 1.0f / FMath::Max(GetOwner()->GetNetUpdateFrequency(), UE_KINDA_SMALL_NUMBER);
+	NewSnapshot.UpdateInterval = static_cast<uint8>(FMath::Clamp(FMath::CeilToInt32(NetUpdateInterval * 100.0f), 0, 255));
+
+	NewSnapshot.ServerTime = static_cast<float>(GetServerTime());
+	ServerSnapshot = NewSnapshot;
+}
+
+void UShooterNetInterpolationComponent::Local_StopInterpolation()
+{
+	SetComponentTickEnabled(false);
+	Snapshots.Reset();
+}
+
+void UShooterNetInterpolationComponent::Local_RestartInterpolation()
+{
+	if (!bEnabled || GetOwnerRole() != ROLE_SimulatedProxy)
+	{
+		return;
+	}
+
+	// snapshots from before the stop belong to another life
+	Snapshots.Reset();
+	bHasInterpolatedAim = false;
+
+	SetComponentTickEnabled(true);
+}
+
+bool UShooterNetInterpolationComponent::GetInterpolatedAimRotation(FRotator& OutAimRotation) const
+{
+	if (bHasInterpolatedAim)
+	{
+		OutAimRotation = InterpolatedAimRotation;
+		return true;
+	}
+
+	return false;
+}
+
+void UShooterNetInterpolationComponent::OnRep_ServerSnapshot()
+{
+	if (!bEnabled || GetOwnerRole() != ROLE_SimulatedProxy)
+	{
+		return;
+	}
+
+	// ignore anything out of order
+	if (Snapshots.Num() > 0)
+	{
+		const FShooterNetSnapshot& Newest = Snapshots.Last();
+
+		if (ServerSnapshot.ServerTime <= Newest.ServerTime)
+		{
+			return;
+		}
+
+		// the server stops sending while the owner rests, so after a long gap assume it started moving
+		// just before the new snapshot instead of sliding slowly across the whole gap
+		if (ServerSnapshot.ServerTime - Newest.ServerTime > MaxSnapshotGap)
+		{
+			FShooterNetSnapshot Resting = Newest;
+			Resting.ServerTime = ServerSnapshot.ServerTime - MaxSnapshotGap;
+			Resting.Velocity = FVector::ZeroVector;
+
+			Snapshots.Add(Resting);
+		}
+	}
+
+	// stay a few update intervals behind, so there are snapshots on both sides of the render time
+	TargetInterpolationDelay = FMath::Max(MinInterpolationDelay, InterpolationDelayIntervals * ServerSnapshot.GetUpdateInterval());
+
+	// the first snapshot sets the delay right away
+	if (Snapshots.Num() == 0)
+	{
+		InterpolationDelay = TargetInterpolationDelay;
+	}
+
+	Snapshots.Add(ServerSnapshot);
+
+	// drop the oldest snapshots past capacity
+	if (Snapshots.Num() > MaxBufferedSnapshots)
+	{
+		Snapshots.RemoveAt(0, Snapshots.Num() - MaxBufferedSnapshots, EAllowShrinking::No);
+	}
+}
+
+void UShooterNetInterpolationComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (Snapshots.Num() == 0)
+	{
+		return;
+	}
+
+	// ease into delay changes so the proxy slows down or catches up instead of jumping
+	InterpolationDelay = FMath::FInterpConstantTo(InterpolationDelay, TargetInterpolationDelay, DeltaTime, InterpolationDelayChangeRate);
+
+	const double RenderTime = GetServerTime() - InterpolationDelay;
+
+	// drop snapshots we've rendered past, keeping the one right before the render time
+	int32 NumExpired = 0;
+
+	while (NumExpired + 1 < Snapshots.Num() && Snapshots[NumExpired + 1].ServerTime <= RenderTime)
+	{
+		++NumExpired;
+	}
+
+	if (NumExpired > 0)
+	{
+		Snapshots.RemoveAt(0, NumExpired, EAllowShrinking::No);
+	}
+
+	FVector Location, Velocity;
+	FRotator AimRotation;
+	float Yaw;
+
+	const FShooterNetSnapshot& From = Snapshots[0];
+
+	if (RenderTime <= From.ServerTime)
+	{
+		// not enough history yet, so hold the oldest snapshot
+		Location = From.Location;
+		Velocity = From.Velocity;
+		AimRotation = From.GetAimRotation();
+		Yaw = From.GetYaw();
+
+	} else if (Snapshots.Num() == 1) {
+
+		// ran out of snapshots, so keep going along the last velocity for a little while
+		const float ExtrapolationTime = FMath::Min(static_cast<float>(RenderTime - From.ServerTime), MaxExtrapolationTime);
+
+		Location = From.Location + From.Velocity * ExtrapolationTime;
+		Velocity = ExtrapolationTime < MaxExtrapolationTime ? FVector(From.Velocity) : FVector::ZeroVector;
+		AimRotation = From.GetAimRotation();
+		Yaw = From.GetYaw();
+
+	} else {
+
+		// Hermite interpolation between the two snapshots around the render time, using the velocities as tangents
+		const FShooterNetSnapshot& To = Snapshots[1];
+
+		const float Span = To.ServerTime - From.ServerTime;
+		const float Alpha = FMath::Clamp(static_cast<float>(RenderTime - From.ServerTime) / Span, 0.0f, 1.0f);
+
+		const FVector FromTangent = From.Velocity * Span;
+		const FVector ToTangent = To.Velocity * Span;
+
+		Location = FMath::CubicInterp(FVector(From.Location), FromTangent, FVector(To.Location), ToTangent, Alpha);
+		Velocity = FMath::CubicInterpDerivative(FVector(From.Location), FromTangent, FVector(To.Location), ToTangent, Alpha) / Span;
+		AimRotation = FMath::Lerp(From.GetAimRotation(), To.GetAimRotation(), Alpha);
+		Yaw = FMath::Lerp(FRotator(0.0f, From.GetYaw(), 0.0f), FRotator(0.0f, To.GetYaw(), 0.0f), Alpha).Yaw;
+	}
+
+	InterpolatedAimRotation = AimRotation;
+	bHasInterpolatedAim = true;
+
+	GetOwner()->SetActorLocationAndRotation(Location, FRotator(0.0f, Yaw, 0.0f));
+
+	// animation reads the speed from the movement component
+	if (ACharacter* Character = GetCharacterOwner())
+	{
+		Character->GetCharacterMovement()->Velocity = Velocity;
+	}
+}
+
+ACharacter* UShooterNetInterpolationComponent::GetCharacterOwner() const
+{
+	return Cast<ACharacter>(GetOwner());
+}
+
+double UShooterNetInterpolationComponent::GetServerTime() const
+{
+	// the game state keeps clients roughly in sync with the server clock
+	if (const AGameStateBase* GameState = GetWorld()->GetGameState())
+	{
+		return GameState->GetServerWorldTimeSeconds();
+	}
+
+	return GetWorld()->GetTimeSeconds();
+}
@@ -0,0 +1,169 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Engine/NetSerialization.h"
+#include "ShooterNetInterpolationComponent.generated.h"
+
+class ACharacter;
+
+/**
+ *  Timestamped movement and aim state of a character, as captured by the server
+ */
+USTRUCT()
+struct DEMO_API FShooterNetSnapshot
+{
+	GENERATED_BODY()
+
+	/** Server world time the snapshot was captured at */
+	UPROPERTY()
+	float ServerTime = 0.0f;
+
+	/** Actor location, rounded to 0.1cm on the wire */
+	UPROPERTY()
+	FVector_NetQuantize10 Location = FVector::ZeroVector;
+
+	/** Actor velocity, rounded to 0.1cm/s on the wire */
+	UPROPERTY()
+	FVector_NetQuantize10 Velocity = FVector::ZeroVector;
+
+	/** Actor yaw, compressed to 16 bits */
+	UPROPERTY()
+	uint16 Yaw = 0;
+
+	/** Aim yaw, compressed to 16 bits */
+	UPROPERTY()
+	uint16 AimYaw = 0;
+
+	/** Aim pitch, compressed to 16 bits */
+	UPROPERTY()
+	uint16 AimPitch = 0;
+
+	/** Owner's net update interval when the snapshot was captured, in 10ms steps */
+	UPROPERTY()
+	uint8 UpdateInterval = 0;
+
+	/** Returns the decompressed aim rotation */
+	FRotator GetAimRotation() const { return FRotator(FRotator::DecompressAxisFromShort(AimPitch), FRotator::DecompressAxisFromShort(AimYaw), 0.0f); }
+
+	/** Returns the decompressed actor yaw */
+	float GetYaw() const { return FRotator::DecompressAxisFromShort(Yaw); }
+
+	/** Returns the owner's net update interval in seconds */
+	float GetUpdateInterval() const { return UpdateInterval * 0.01f; }
+
+	/** Returns true if the movement and aim are close enough to the other snapshot's to skip sending */
+	bool IsSameState(const FShooterNetSnapshot& Other) const;
+
+	/** Serializes the snapshot as a single unit so the client never sees half of an update */
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FShooterNetSnapshot> : public TStructOpsTypeTraitsBase2<FShooterNetSnapshot>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/**
+ *  Replaces the default character movement replication with a snapshot interpolation buffer
+ *  The server captures a snapshot whenever the owner is about to replicate.
+ *  Simulated proxies buffer the snapshots and render them in the past, delayed by a few of the owner's
+ *  net update intervals, using Hermite interpolation between snapshots so low update rates still look smooth
+ */
+UCLASS(ClassGroup="Shooter", meta=(BlueprintSpawnableComponent))
+class DEMO_API UShooterNetInterpolationComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** If false, the owner keeps using the default character movement replication */
+	UPROPERTY(EditAnywhere, Category="Network")
+	bool bEnabled = true;
+
+	/** Number of the owner's net update intervals simulated proxies are rendered in the past. Should be at least two */
+	UPROPERTY(EditAnywhere, Category="Network", meta = (ClampMin = 1, ClampMax = 5))
+	float InterpolationDelayIntervals = 2.0f;
+
+	/** Minimum time in the past simulated proxies are rendered, to absorb jitter at high update rates */
+	UPROPERTY(EditAnywhere, Category="Network", meta = (ClampMin = 0, ClampMax = 1, Units = "s"))
+	float MinInterpolationDelay = 0.1f;
+
+	/** Rate at which the interpolation delay follows update rate changes, in seconds of delay per second */
+	UPROPERTY(EditAnywhere, Category="Network", meta = (ClampMin = 0.01, ClampMax = 1))
+	float InterpolationDelayChangeRate = 0.25f;
+
+	/** Max time to keep moving along the last known velocity when snapshots run out */
+	UPROPERTY(EditAnywhere, Category="Network", meta = (ClampMin = 0, ClampMax = 1, Units = "s"))
+	float MaxExtrapolationTime = 0.25f;
+
+	/** Snapshots further apart than this are treated as the owner resting until shortly before the newer one */
+	UPROPERTY(EditAnywhere, Category="Network", meta = (ClampMin = 0.1, ClampMax = 5, Units = "s"))
+	float MaxSnapshotGap = 0.5f;
+
+	/** Max number of snapshots kept on simulated proxies */
+	UPROPERTY(EditAnywhere, Category="Network", meta = (ClampMin = 2, ClampMax = 64))
+	int32 MaxBufferedSnapshots = 16;
+
+	/** Latest snapshot captured by the server */
+	UPROPERTY(ReplicatedUsing=OnRep_ServerSnapshot)
+	FShooterNetSnapshot ServerSnapshot;
+
+	/** Snapshots received by a simulated proxy, oldest first */
+	TArray<FShooterNetSnapshot> Snapshots;
+
+	/** Interpolation delay the simulated proxy is moving towards, derived from the latest snapshot's update interval */
+	float TargetInterpolationDelay = 0.0f;
+
+	/** How far in the past the simulated proxy is currently rendered */
+	float InterpolationDelay = 0.0f;
+
+	/** Interpolated aim rotation on simulated proxies */
+	FRotator InterpolatedAimRotation = FRotator::ZeroRotator;
+
+	/** If true, InterpolatedAimRotation holds a valid value */
+	bool bHasInterpolatedAim = false;
+
+public:
+
+	/** Constructor */
+	UShooterNetInterpolationComponent();
+
+	/** Captures the owner's current state for replication. Called from the owner's PreReplication */
+	void Auth_CaptureSnapshot();
+
+	/** Stops moving the owner on this machine, e.g. when it switches to ragdoll physics */
+	void Local_StopInterpolation();
+
+	/** Starts moving the owner from snapshots again, e.g. when it comes back from ragdoll */
+	void Local_RestartInterpolation();
+
+	/** Returns true and the interpolated aim rotation if this is a simulated proxy with snapshots */
+	bool GetInterpolatedAimRotation(FRotator& OutAimRotation) const;
+
+protected:
+
+	/** Gameplay initialization */
+	virtual void BeginPlay() override;
+
+	/** Samples the snapshot buffer and moves the owner */
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	virtual void GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** Adds the new server snapshot to the buffer */
+	UFUNCTION()
+	void OnRep_ServerSnapshot();
+
+	/** Returns the owning character */
+	ACharacter* GetCharacterOwner() const;
+
+	/** Returns the server world time as known by this machine */
+	double GetServerTime() const;
+};
@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/Net/ShooterNetRateComponent.h"
+#include "GameFramework/Actor.h"
+
+UShooterNetRateComponent::UShooterNetRateComponent()
+{
+	// the decay doesn't need per-frame precision
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	PrimaryComponentTick.TickInterval = 0.1f;
+}
+
+void UShooterNetRateComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// net rates only matter on the server
+	if (GetOwner()->HasAuthority())
+	{
+		// let the engine's adaptive update logic use the same floor
+		GetOwner()->SetMinNetUpdateFrequency(IdleNetUpdateFrequency);
+
+		// start idle until something happens
+		CurrentFrequency = IdleNetUpdateFrequency;
+		ApplyFrequency(true);
+
+		SetComponentTickEnabled(true);
+	}
+}
+
+void UShooterNetRateComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	// fast moving actors need the high rate so clients don't see them pop
+	if (GetOwner()->GetVelocity().SizeSquared() > FMath::Square(FastMoveSpeed))
+	{
+		CurrentFrequency = ActiveNetUpdateFrequency;
+
+	} else {
+
+		// exponentially decay towards the idle floor
+		const float Alpha = FMath::Exp2(-DeltaTime / DecayHalfLife);
+		CurrentFrequency = IdleNetUpdateFrequency + (CurrentFrequency - IdleNetUpdateFrequency) * Alpha;
+
+		// snap to the floor once we're close enough so the decay settles
+		if (CurrentFrequency - IdleNetUpdateFrequency < MinFrequencyDelta)
+		{
+			CurrentFrequency = IdleNetUpdateFrequency;
+		}
+	}
+
+	ApplyFrequency(false);
+}
+
+void UShooterNetRateComponent::Auth_NotifyActivity()
+{
+	if (!GetOwner()->HasAuthority())
+	{
+		return;
+	}
+
+	// were we throttled down? if so, don't wait for the next slow update to send this change
+	const bool bWasThrottled = AppliedFrequency < ActiveNetUpdateFrequency - MinFrequencyDelta;
+
+	CurrentFrequency = ActiveNetUpdateFrequency;
+	ApplyFrequency(false);
+
+	if (bWasThrottled)
+	{
+		GetOwner()->ForceNetUpdate();
+	}
+}
+
+void UShooterNetRateComponent::Auth_NotifyActivity(AActor* Actor)
+{
+	if (IsValid(Actor))
+	{
+		if (UShooterNetRateComponent* NetRate = Actor->FindComponentByClass<UShooterNetRateComponent>())
+		{
+			NetRate->Auth_NotifyActivity();
+		}
+	}
+}
+
+void UShooterNetRateComponent::ApplyFrequency(bool bForce)
+{
+	if (!bForce)
+	{
+		// nothing to do if we're already there
+		if (CurrentFrequency == AppliedFrequency)
+		{
+			return;
+		}
+
+		// skip small changes, they cost more in net driver bookkeeping than they save. Always settle on the floor
+		if (CurrentFrequency != IdleNetUpdateFrequency && FMath::Abs(CurrentFrequency - AppliedFrequency) < MinFrequencyDelta)
+		{
+			return;
+		}
+	}
+
+	AppliedFrequency = CurrentFrequency;
+	GetOwner()->SetNetUpdateFrequency(AppliedFrequency);
+}
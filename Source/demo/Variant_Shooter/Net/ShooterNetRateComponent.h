@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "ShooterNetRateComponent.generated.h"
+
+/**
+ *  Server-side controller for the owning actor's net update frequency
+ *  Raises the rate when the owner fires, takes damage or moves fast
+ *  Decays the rate back towards an idle floor while nothing is happening
+ */
+UCLASS(ClassGroup="Shooter", meta=(BlueprintSpawnableComponent))
+class DEMO_API UShooterNetRateComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Net update frequency the owner decays towards while idle */
+	UPROPERTY(EditAnywhere, Category="Network", meta = (ClampMin = 1, ClampMax = 100, Units = "Hz"))
+	float IdleNetUpdateFrequency = 4.0f;
+
+	/** Net update frequency applied right after gameplay activity */
+	UPROPERTY(EditAnywhere, Category="Network", meta = (ClampMin = 1, ClampMax = 200, Units = "Hz"))
+	float ActiveNetUpdateFrequency = 60.0f;
+
+	/** Time it takes the update frequency to decay halfway from its current value to the idle floor */
+	UPROPERTY(EditAnywhere, Category="Network", meta = (ClampMin = 0.05, ClampMax = 10, Units = "s"))
+	float DecayHalfLife = 0.75f;
+
+	/** Owner speed above which it's considered active */
+	UPROPERTY(EditAnywhere, Category="Network", meta = (ClampMin = 0, ClampMax = 10000, Units = "cm/s"))
+	float FastMoveSpeed = 250.0f;
+
+	/** Minimum change before a new frequency is pushed to the owner, to avoid churning the net driver */
+	UPROPERTY(EditAnywhere, Category="Network", meta = (ClampMin = 0, ClampMax = 50, Units = "Hz"))
+	float MinFrequencyDelta = 2.0f;
+
+	/** Frequency the controller is currently decaying */
+	float CurrentFrequency = 0.0f;
+
+	/** Last frequency pushed to the owner */
+	float AppliedFrequency = 0.0f;
+
+public:
+
+	/** Constructor */
+	UShooterNetRateComponent();
+
+	/** Bumps the owner to the active rate and pushes an update out right away */
+	void Auth_NotifyActivity();
+
+	/** Bumps the net rate component on the passed actor, if it has one */
+	static void Auth_NotifyActivity(AActor* Actor);
+
+protected:
+
+	/** Gameplay initialization */
+	virtual void BeginPlay() override;
+
+	/** Decays the rate and polls the owner velocity */
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/** Pushes the current frequency to the owner if it changed enough */
+	void ApplyFrequency(bool bForce);
+};
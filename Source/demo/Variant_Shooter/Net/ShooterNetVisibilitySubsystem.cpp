@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Variant_Shooter/Net/ShooterNetVisibilitySubsystem.h"
+#include "ShooterLineOfSight.h"
+#include "ShooterLineOfSightSubsystem.h"
+#include "GenericTeamAgentInterface.h"
+#include "Engine/World.h"
+
+bool UShooterNetVisibilitySubsystem::IsVisibleTo(const AActor* Target, const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation)
+{
+	// only enemies are culled. Spectators and teammates always see everything
+	if (!bEnabled || !AreEnemies(ViewTarget, Target))
+	{
+		return true;
+	}
+
+	// close enemies are always relevant
+	if (FVector::DistSquared(SrcLocation, Target->GetActorLocation()) < FMath::Square(AlwaysRelevantDistance))
+	{
+		return true;
+	}
+
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	// find or add the cached pair
+	const TPair<const AActor*, const AActor*> Key(RealViewer, Target);
+
+	int32 EntryIndex = INDEX_NONE;
+
+	if (const int32* FoundIndex = EntryLookup.Find(Key))
+	{
+		EntryIndex = *FoundIndex;
+
+	} else {
+
+		// new pairs start visible until their first check comes in. Hiding too early gets players shot by invisible enemies
+		EntryIndex = Entries.AddDefaulted();
+		EntryLookup.Add(Key, EntryIndex);
+
+		FVisibilityEntry& NewEntry = Entries[EntryIndex];
+		NewEntry.Key = Key;
+		NewEntry.Viewer = RealViewer;
+		NewEntry.Target = Target;
+		NewEntry.bVisible = true;
+		NewEntry.LastVisibleTime = Now;
+	}
+
+	// refresh the viewpoint for the next trace
+	FVisibilityEntry& Entry = Entries[EntryIndex];
+	Entry.ViewLocation = SrcLocation;
+	Entry.ViewTarget = ViewTarget;
+	Entry.LastQueryTime = Now;
+
+	return Entry.bVisible || (Now - Entry.LastVisibleTime) < GracePeriod;
+}
+
+bool UShooterNetVisibilitySubsystem::AreEnemies(const AActor* ViewTarget, const AActor* Target)
+{
+	// actors that aren't team agents come back as neutral and are never culled
+	return FGenericTeamId::GetAttitude(ViewTarget, Target) == ETeamAttitude::Hostile;
+}
+
+bool UShooterNetVisibilitySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UShooterNetVisibilitySubsystem::Tick(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+
+	// relevancy is only decided on the server
+	if (World->GetNetMode() == NM_Client || World->GetNetMode() == NM_Standalone)
+	{
+		return;
+	}
+
+	const double Now = World->GetTimeSeconds();
+
+	// discard pairs for actors that are gone or that the net driver stopped asking about
+	for (int32 i = Entries.Num() - 1; i >= 0; --i)
+	{
+		const FVisibilityEntry& Entry = Entries[i];
+
+		if (!Entry.Viewer.IsValid() || !Entry.Target.IsValid() || (Now - Entry.LastQueryTime) > StaleEntryTime)
+		{
+			RemoveEntry(i);
+		}
+	}
+
+	if (Entries.Num() == 0)
+	{
+		return;
+	}
+
+	const UShooterLineOfSightSubsystem* LineOfSight = World->GetSubsystem<UShooterLineOfSightSubsystem>();
+
+	// refresh a slice of the pairs
+	const int32 NumToProcess = FMath::Min(MaxPairsPerFrame, Entries.Num());
+
+	for (int32 i = 0; i < NumToProcess; ++i)
+	{
+		if (NextEntry >= Entries.Num())
+		{
+			NextEntry = 0;
+		}
+
+		FVisibilityEntry& Entry = Entries[NextEntry++];
+
+		// pairs in mutually invisible cells skip the traces
+		if (LineOfSight && !LineOfSight->IsPotentiallyVisible(Entry.ViewLocation, Entry.Target->GetActorLocation()))
+		{
+			Entry.bVisible = false;
+			continue;
+		}
+
+		Entry.bVisible = FShooterLineOfSight::HasLineOfSight(World, Entry.ViewLocation, Entry.Target.Get(), NumberOfVerticalChecks, Entry.ViewTarget.Get());
+
+		if (Entry.bVisible)
+		{
+			Entry.LastVisibleTime = Now;
+		}
+	}
+}
+
+TStatId UShooterNetVisibilitySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterNetVisibilitySubsystem, STATGROUP_Tickables);
+}
+
+void UShooterNetVisibilitySubsystem::RemoveEntry(int32 Index)
+{
+	EntryLookup.Remove(Entries[Index].Key);
+
+	// swap the last entry in and fix up its lookup
+	Entries.RemoveAtSwap(Index, EAllowShrinking::No);
+
+	if (Entries.IsValidIndex(Index))
+	{
+		EntryLookup.Add(Entries[Index].Key, Index);
+	}
+}
@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterNetVisibilitySubsystem.generated.h"
+
+/**
+ *  Server-side network fog of war
+ *  Keeps a coarse, cached line of sight result between each connection's viewpoint and each enemy character
+ *  Results are refreshed round-robin, a limited number of pairs per frame
+ *  Enemies that have been occluded for longer than the grace period are dropped from the connection's relevancy
+ */
+UCLASS(config=Game)
+class DEMO_API UShooterNetVisibilitySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Cached visibility between a viewer and a target */
+	struct FVisibilityEntry
+	{
+		/** Raw pointer pair used as the lookup key. Kept so the entry can be removed after the actors are gone */
+		TPair<const AActor*, const AActor*> Key;
+
+		/** Actor viewing. Usually a player controller */
+		TWeakObjectPtr<const AActor> Viewer;
+
+		/** Enemy being checked */
+		TWeakObjectPtr<const AActor> Target;
+
+		/** Viewpoint passed in by the net driver on the last relevancy check */
+		FVector ViewLocation = FVector::ZeroVector;
+
+		/** Actor the viewer is looking through, ignored by the traces */
+		TWeakObjectPtr<const AActor> ViewTarget;
+
+		/** Last time the target was seen from the viewpoint */
+		double LastVisibleTime = 0.0;
+
+		/** Last time the net driver asked about this pair */
+		double LastQueryTime = 0.0;
+
+		/** Result of the last trace */
+		bool bVisible = true;
+	};
+
+	/** If false, culling is disabled and every enemy stays relevant */
+	UPROPERTY(Config)
+	bool bEnabled = true;
+
+	/** Max number of viewer/target pairs to trace per frame */
+	UPROPERTY(Config)
+	int32 MaxPairsPerFrame = 32;
+
+	/** Number of vertical samples over the target's bounds for each pair */
+	UPROPERTY(Config)
+	int32 NumberOfVerticalChecks = 3;
+
+	/** Time an enemy stays relevant after it was last seen, so peeking around corners doesn't pop */
+	UPROPERTY(Config)
+	float GracePeriod = 1.5f;
+
+	/** Enemies closer than this are always relevant. Covers audio and fast close-quarters movement */
+	UPROPERTY(Config)
+	float AlwaysRelevantDistance = 1500.0f;
+
+	/** Pairs the net driver hasn't asked about for this long are discarded */
+	UPROPERTY(Config)
+	float StaleEntryTime = 3.0f;
+
+	/** Cached pairs */
+	TArray<FVisibilityEntry> Entries;
+
+	/** Maps a viewer/target pair to its index in the entries array */
+	TMap<TPair<const AActor*, const AActor*>, int32> EntryLookup;
+
+	/** Round-robin position in the entries array */
+	int32 NextEntry = 0;
+
+public:
+
+	/**
+	 * @brief Checks whether an enemy should be relevant to a viewer. Called from IsNetRelevantFor
+	 * @param Target actor being considered for replication
+	 * @param RealViewer actor owning the connection, usually a player controller
+	 * @param ViewTarget actor the connection is viewing through
+	 * @param SrcLocation viewpoint location
+	 * @return false only if the target is an enemy that's been occluded for longer than the grace period
+	 */
+	bool IsVisibleTo(const AActor* Target, const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation);
+
+	/** Returns true if both actors belong to teams and those teams are different */
+	static bool AreEnemies(const AActor* ViewTarget, const AActor* Target);
+
+protected:
+
+	//~Begin UTickableWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End UTickableWorldSubsystem interface
+
+	/** Removes the entry at the passed index, keeping the lookup in sync */
+	void RemoveEntry(int32 Index);
+};
@@ -6,6 +6,10 @@
 #include "demo.h"
 #include "DemoPlayerState.h"
 #include "ShooterWeapon.h"
+#include "ShooterNetRateComponent.h"
+#include "ShooterNetVisibilitySubsystem.h"
+#include "ShooterJoinReplicationSubsystem.h"
+#include "ShooterInfluenceMapSubsystem.h"
 #include "EnhancedInputComponent.h"
 #include "Components/InputComponent.h"
 #include "Components/PawnNoiseEmitterComponent.h"
@@ -13,6 +17,8 @@
 #include "Components/SkeletalMeshComponent.h"
 #include "Engine/World.h"
 #include "Camera/CameraComponent.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerState.h"
 #include "TimerManager.h"
 #include "ShooterGameMode.h"
 #include "Net/UnrealNetwork.h"
@@ -23,42 +29,144 @@ AShooterCharacter::AShooterCharacter()
 	// create the noise emitter component
 	PawnNoiseEmitter = CreateDefaultSubobject<UPawnNoiseEmitterComponent>(TEXT("Pawn Noise Emitter"));
 
+	// create the net rate component
+	NetRate = CreateDefaultSubobject<UShooterNetRateComponent>(TEXT("Net Rate"));
+
 	// configure movement
 	GetCharacterMovement()->RotationRate = FRotator(0.0f, 600.0f, 0.0f);
 }
 
-void AShooterCharacter::OnRep_CurrentWeapon(AShooterWeapon* OldWeapon)
+void AShooterCharacter::OnRep_CurrentWeapon()
 {
-	OnWeaponDeactivated(OldWeapon);
-	OnWeaponActivated(CurrentWeapon);
+	Local_ReconcileWeapon();
 }
 
-void AShooterCharacter::OnRep_CurrentHP()
+void AShooterCharacter::OnRep_ConfirmedSwitchCount()
 {
-	OnDamaged.Broadcast(FMath::Max(0.0f, CurrentHP / MaxHP));
+	Local_ReconcileWeapon();
+}
+
+void AShooterCharacter::OnRep_CombatState(const FCombatNetState& OldState)
+{
+	// the server keeps the full precision HP
+	if (!HasAuthority())
+	{
+		CurrentHP = CombatState.GetHealth(MaxHP);
+	}
+
+	if (CombatState.HealthFraction != OldState.HealthFraction)
+	{
+		OnDamaged.Broadcast(FMath::Max(0.0f, CurrentHP / MaxHP));
+	}
+
+	if (CombatState.Bullets != OldState.Bullets || CombatState.MagazineSize != OldState.MagazineSize)
+	{
+		OnBulletCountUpdated.Broadcast(CombatState.MagazineSize, CombatState.Bullets);
+	}
 }
 
 void AShooterCharacter::GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
-	DOREPLIFETIME(AShooterCharacter, CurrentHP);
+	DOREPLIFETIME(AShooterCharacter, CombatState);
+	DOREPLIFETIME(AShooterCharacter, DeathInfo);
 	DOREPLIFETIME(AShooterCharacter, OwnedWeapons);
 	DOREPLIFETIME(AShooterCharacter, CurrentWeapon);
+	DOREPLIFETIME_CONDITION(AShooterCharacter, ConfirmedSwitchCount, COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(AShooterCharacter, ConfirmedInputSequence, COND_OwnerOnly);
 }
 
-void AShooterCharacter::Server_StartFiring_Implementation()
+void AShooterCharacter::Server_UpdateInput_Implementation(FShooterInputState InputState)
 {
-	Auth_StartFiring();
+	// ignore repeats and updates that arrived out of order
+	const FShooterInputState& LatestInput = bHasPendingInput ? PendingInput : AppliedInput;
+
+	if (!LatestInput.IsOlderThan(InputState.Sequence))
+	{
+		return;
+	}
+
+	// refill the rate limit tokens
+	const double Now = GetWorld()->GetTimeSeconds();
+	InputRateTokens = FMath::Min(MaxInputUpdatesPerSecond, InputRateTokens + static_cast<float>(Now - InputRateRefillTime) * MaxInputUpdatesPerSecond);
+	InputRateRefillTime = Now;
+
+	// drop updates over the rate limit. The state is absolute, so the next accepted update catches up
+	if (InputRateTokens < 1.0f)
+	{
+		return;
+	}
+
+	InputRateTokens -= 1.0f;
+
+	// only the latest update is applied on the next tick
+	PendingInput = InputState;
+	bHasPendingInput = true;
 }
 
-void AShooterCharacter::Server_StopFiring_Implementation()
+void AShooterCharacter::Auth_ApplyInput(const FShooterInputState& InputState)
 {
-	Auth_StopFiring();
+	// apply the trigger only if it changed, so press and release within a tick cancel out
+	if (InputState.bFireHeld != AppliedInput.bFireHeld)
+	{
+		if (InputState.bFireHeld)
+		{
+			Auth_StartFiring();
+
+		} else {
+
+			Auth_StopFiring();
+		}
+	}
+
+	// collapse all switch requests since the last update into a single switch
+	const uint8 SwitchSteps = InputState.SwitchCount - AppliedInput.SwitchCount;
+
+	if (SwitchSteps > 0)
+	{
+		Auth_SwitchWeapon(SwitchSteps);
+	}
+
+	// let the owning client know which of its predicted switches have been applied
+	ConfirmedSwitchCount = InputState.SwitchCount;
+	ConfirmedInputSequence = InputState.Sequence;
+
+	AppliedInput = InputState;
 }
 
-void AShooterCharacter::Server_SwitchWeapon_Implementation()
+void AShooterCharacter::Local_FlushInput()
 {
-	Auth_SwitchWeapon();
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	// keep sending the last update until the server applies it, in case every copy was lost
+	const bool bUnconfirmed = LocalInput.Sequence != ConfirmedInputSequence || LocalInput.SwitchCount != ConfirmedSwitchCount;
+	const bool bAwaitingConfirmation = bUnconfirmed && Now - LastInputSendTime >= UnconfirmedInputResendInterval;
+
+	if (!bLocalInputDirty && InputResendsLeft <= 0 && !bAwaitingConfirmation)
+	{
+		return;
+	}
+
+	// respect the same rate limit the server enforces
+	if (Now - LastInputSendTime < 1.0 / MaxInputUpdatesPerSecond)
+	{
+		return;
+	}
+
+	if (bLocalInputDirty)
+	{
+		// a new state gets a new sequence number and a fresh set of repeats
+		++LocalInput.Sequence;
+		bLocalInputDirty = false;
+		InputResendsLeft = InputRedundancy;
+
+	} else if (InputResendsLeft > 0) {
+
+		--InputResendsLeft;
+	}
+
+	LastInputSendTime = Now;
+	Server_UpdateInput(LocalInput);
 }
 
 void AShooterCharacter::Auth_StopFiring()
@@ -66,6 +174,8 @@ void AShooterCharacter::Auth_StopFiring()
 	if (GetLocalRole() != ROLE_Authority)
 		return;
 
+	CombatState.bIsFiring = false;
+
 	if (CurrentWeapon)
 	{
 		CurrentWeapon->Auth_StopFiring();
@@ -77,39 +187,110 @@ void AShooterCharacter::Auth_StartFiring()
 	if (GetLocalRole() != ROLE_Authority)
 		return;
 
+	CombatState.bIsFiring = true;
+
 	if (CurrentWeapon)
 	{
 		CurrentWeapon->Auth_StartFiring();
 	}
 }
 
-void AShooterCharacter::Auth_SwitchWeapon()
+void AShooterCharacter::Auth_SwitchWeapon(int32 Steps)
 {
 	if (OwnedWeapons.Num() > 1)
 	{
-		CurrentWeapon->DeactivateWeapon();
-		int32 WeaponIndex = OwnedWeapons.Find(CurrentWeapon);
-		if (WeaponIndex == OwnedWeapons.Num() - 1)
+		// cycling through every weapon lands back where we started
+		const int32 WeaponIndex = (OwnedWeapons.Find(CurrentWeapon) + Steps) % OwnedWeapons.Num();
+
+		if (OwnedWeapons[WeaponIndex] == CurrentWeapon)
 		{
-			WeaponIndex = 0;
-		}
-		else {
-			++WeaponIndex;
+			return;
 		}
+
+		CurrentWeapon->DeactivateWeapon();
 		CurrentWeapon = OwnedWeapons[WeaponIndex];
 		CurrentWeapon->ActivateWeapon();
 	}
 }
 
+void AShooterCharacter::Local_PredictSwitchWeapon()
+{
+	// predict from the weapon we're showing, which may already be ahead of the server
+	AShooterWeapon* FromWeapon = EquippedWeapon ? EquippedWeapon.Get() : CurrentWeapon.Get();
+
+	if (OwnedWeapons.Num() > 1 && FromWeapon)
+	{
+		const int32 WeaponIndex = (OwnedWeapons.Find(FromWeapon) + 1) % OwnedWeapons.Num();
+
+		Local_EquipWeapon(OwnedWeapons[WeaponIndex]);
+	}
+}
+
+void AShooterCharacter::Local_ReconcileWeapon()
+{
+	// the server hasn't applied all of our switches yet, so keep showing the predicted weapon
+	if (IsLocallyControlled() && LocalInput.SwitchCount != ConfirmedSwitchCount)
+	{
+		return;
+	}
+
+	// confirm the prediction, or roll back to the server's weapon if it differs. Dead characters show no weapon
+	Local_EquipWeapon(DeathInfo.IsDead() ? nullptr : CurrentWeapon.Get());
+}
+
+void AShooterCharacter::Local_EquipWeapon(AShooterWeapon* Weapon)
+{
+	if (Weapon == EquippedWeapon)
+	{
+		return;
+	}
+
+	// weapon visibility replicates as well, this just gets there first
+	if (EquippedWeapon)
+	{
+		EquippedWeapon->SetActorHiddenInGame(true);
+		OnWeaponDeactivated(EquippedWeapon);
+	}
+
+	if (Weapon)
+	{
+		Weapon->SetActorHiddenInGame(false);
+		OnWeaponActivated(Weapon);
+	}
+}
+
+void AShooterCharacter::ApplyWeaponAnimation(USkeletalMeshComponent* Mesh, const TSubclassOf<UAnimInstance>& LayerClass, const TSubclassOf<UAnimInstance>& InstanceClass)
+{
+	if (LayerClass)
+	{
+		// linking layers keeps the main anim instance and its state alive
+		Mesh->LinkAnimClassLayers(LayerClass);
+
+	} else if (Mesh->GetAnimClass() != InstanceClass) {
+
+		// weapons without layers rebuild the anim instance
+		Mesh->SetAnimInstanceClass(InstanceClass);
+	}
+}
+
 void AShooterCharacter::BeginPlay()
 {
 	Super::BeginPlay();
 
-	// reset HP to max
-	CurrentHP = MaxHP;
+	if (HasAuthority())
+	{
+		// reset HP to max
+		CurrentHP = MaxHP;
+		CombatState.SetHealth(CurrentHP, MaxHP);
+
+	} else {
+
+		// the combat state may have replicated in before BeginPlay
+		CurrentHP = CombatState.GetHealth(MaxHP);
+	}
 
 	// update the HUD
-	OnDamaged.Broadcast(1.0f);
+	OnDamaged.Broadcast(GetHealthPercent());
 }
 
 void AShooterCharacter::EndPlay(EEndPlayReason::Type EndPlayReason)
@@ -120,6 +301,26 @@ void AShooterCharacter::EndPlay(EEndPlayReason::Type EndPlayReason)
 	GetWorld()->GetTimerManager().ClearTimer(RespawnTimer);
 }
 
+void AShooterCharacter::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (HasAuthority())
+	{
+		// apply the latest input update received since the last tick
+		if (bHasPendingInput)
+		{
+			bHasPendingInput = false;
+			Auth_ApplyInput(PendingInput);
+		}
+
+	} else if (IsLocallyControlled()) {
+
+		// send at most one input update per tick
+		Local_FlushInput();
+	}
+}
+
 void AShooterCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
 {
 	// base class handles move, aim and jump inputs
@@ -155,9 +356,21 @@ float AShooterCharacter::Auth_TakeDamage(float Damage, struct FDamageEvent const
 	if (GetLocalRole() != ROLE_Authority)
 		return 0.0f;
 	
+	const FCombatNetState OldState = CombatState;
+
 	CurrentHP -= Damage;
+	CombatState.SetHealth(CurrentHP, MaxHP);
 	
-	SV_REPCALL(CurrentHP);
+	SV_REPCALL_PREV(CombatState, OldState);
+
+	// being shot at is combat, so replicate at the active rate
+	NetRate->Auth_NotifyActivity();
+
+	// mark the hit on the tactical map
+	if (UShooterInfluenceMapSubsystem* InfluenceMap = GetWorld()->GetSubsystem<UShooterInfluenceMapSubsystem>())
+	{
+		InfluenceMap->Auth_ReportDamage(this, Damage, EventInstigator ? EventInstigator->GetPawn() : nullptr);
+	}
 	
 	if (CurrentHP <= 0.0f)
 	{
@@ -182,7 +395,9 @@ void AShooterCharacter::DoStartFiring()
 	}
 	else
 	{
-		Server_StartFiring();
+		// sent with the next input update
+		bLocalInputDirty |= !LocalInput.bFireHeld;
+		LocalInput.bFireHeld = true;
 	}
 }
 
@@ -194,7 +409,9 @@ void AShooterCharacter::DoStopFiring()
 	}
 	else
 	{
-		Server_StopFiring();
+		// sent with the next input update
+		bLocalInputDirty |= LocalInput.bFireHeld;
+		LocalInput.bFireHeld = false;
 	}
 }
 
@@ -206,8 +423,39 @@ void AShooterCharacter::DoSwitchWeapon()
 	}
 	else
 	{
-		Server_SwitchWeapon();
+		// switch right away. The switch count doubles as the prediction key
+		++LocalInput.SwitchCount;
+		bLocalInputDirty = true;
+
+		Local_PredictSwitchWeapon();
+	}
+}
+
+bool AShooterCharacter::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	if (!Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation))
+	{
+		return false;
+	}
+
+	// late joiners receive their own pawn first, then nearby characters
+	if (UShooterJoinReplicationSubsystem* JoinReplication = GetWorld()->GetSubsystem<UShooterJoinReplicationSubsystem>())
+	{
+		const EShooterJoinPriority Priority = ViewTarget == this ? EShooterJoinPriority::Essential : JoinReplication->GetPriorityByDistance(this, SrcLocation, EShooterJoinPriority::Combat, EShooterJoinPriority::World);
+
+		if (!JoinReplication->IsUnlockedFor(RealViewer, Priority))
+		{
+			return false;
+		}
+	}
+
+	// enemies behind walls are dropped from the connection
+	if (UShooterNetVisibilitySubsystem* Visibility = GetWorld()->GetSubsystem<UShooterNetVisibilitySubsystem>())
+	{
+		return Visibility->IsVisibleTo(this, RealViewer, ViewTarget, SrcLocation);
 	}
+
+	return true;
 }
 
 void AShooterCharacter::AttachWeaponMeshes(AShooterWeapon* Weapon)
@@ -236,7 +484,17 @@ void AShooterCharacter::AddWeaponRecoil(float Recoil)
 
 void AShooterCharacter::UpdateWeaponHUD(int32 CurrentAmmo, int32 MagazineSize)
 {
-	OnBulletCountUpdated.Broadcast(MagazineSize, CurrentAmmo);
+	if (!HasAuthority())
+	{
+		OnBulletCountUpdated.Broadcast(MagazineSize, CurrentAmmo);
+		return;
+	}
+
+	// ammo reaches clients through the combat state
+	const FCombatNetState OldState = CombatState;
+	CombatState.SetAmmo(CurrentAmmo, MagazineSize);
+
+	SV_REPCALL_PREV(CombatState, OldState);
 }
 
 FVector AShooterCharacter::GetWeaponTargetLocation()
@@ -293,15 +551,29 @@ void AShooterCharacter::AddWeaponClass(const TSubclassOf<AShooterWeapon>& Weapon
 void AShooterCharacter::OnWeaponActivated(AShooterWeapon* Weapon)
 {
 	UE_LOG(LogTemp, Log, TEXT("%s::OnWeaponActivated - Role: %s"), *GetName(), *UEnum::GetValueAsString(GetLocalRole()));
-	OnBulletCountUpdated.Broadcast(Weapon->GetMagazineSize(), Weapon->GetBulletCount());
+
+	// only the server knows the weapon's bullet count. Clients read it from the combat state
+	if (HasAuthority())
+	{
+		UpdateWeaponHUD(Weapon->GetBulletCount(), Weapon->GetMagazineSize());
+
+	} else {
+
+		OnBulletCountUpdated.Broadcast(CombatState.MagazineSize, CombatState.Bullets);
+	}
 	
-	GetFirstPersonMesh()->SetAnimInstanceClass(Weapon->GetFirstPersonAnimInstanceClass());
-	GetMesh()->SetAnimInstanceClass(Weapon->GetThirdPersonAnimInstanceClass());
+	EquippedWeapon = Weapon;
+
+	ApplyWeaponAnimation(GetFirstPersonMesh(), Weapon->GetFirstPersonAnimLayerClass(), Weapon->GetFirstPersonAnimInstanceClass());
+	ApplyWeaponAnimation(GetMesh(), Weapon->GetThirdPersonAnimLayerClass(), Weapon->GetThirdPersonAnimInstanceClass());
 }
 
 void AShooterCharacter::OnWeaponDeactivated(AShooterWeapon* Weapon)
 {
-	// unused
+	if (EquippedWeapon == Weapon)
+	{
+		EquippedWeapon = nullptr;
+	}
 }
 
 void AShooterCharacter::OnSemiWeaponRefire()
@@ -336,25 +608,59 @@ void AShooterCharacter::Auth_Die(AController* KillerController)
 		}
 	}	
 	
+	CombatState.bIsDead = true;
+	CombatState.bIsFiring = false;
+
+	// deaths make the area dangerous for a while
+	if (UShooterInfluenceMapSubsystem* InfluenceMap = GetWorld()->GetSubsystem<UShooterInfluenceMapSubsystem>())
+	{
+		InfluenceMap->Auth_ReportDeath(GetActorLocation());
+	}
+
+	// record the death. Clients pick it up whenever the character is relevant to them
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	DeathInfo.DeathTime = FMath::Max(GameState ? static_cast<float>(GameState->GetServerWorldTimeSeconds()) : GetWorld()->GetTimeSeconds(), UE_KINDA_SMALL_NUMBER);
+	DeathInfo.KillerId = KillerController && KillerController->PlayerState ? KillerController->PlayerState->GetPlayerId() : INDEX_NONE;
+
 	GetWorld()->GetTimerManager().SetTimer(RespawnTimer, this, &AShooterCharacter::Auth_OnRespawn, RespawnTime, false);
-	MC_Die();
+
+	// the server stops the character too, so run the notify even on dedicated servers
+	OnRep_DeathInfo();
+
+	// only the owner needs to hear about it right away
+	Client_OnDied();
 }
 
-void AShooterCharacter::MC_Die_Implementation()
+void AShooterCharacter::OnRep_DeathInfo()
 {
-	if (IsValid(CurrentWeapon))
+	if (!DeathInfo.IsDead())
 	{
-		CurrentWeapon->DeactivateWeapon();
+		return;
 	}
-	
+
+	if (HasAuthority())
+	{
+		if (IsValid(CurrentWeapon))
+		{
+			CurrentWeapon->DeactivateWeapon();
+		}
+
+	} else {
+
+		// weapon visibility replicates, this just hides it right away
+		Local_EquipWeapon(nullptr);
+	}
+
 	GetCharacterMovement()->StopMovementImmediately();
 	DisableInput(nullptr);
-	
+
 	BP_OnDeath();
-	if (IsLocallyControlled())
-	{
-		OnBulletCountUpdated.Broadcast(0, 0);
-	}
+}
+
+void AShooterCharacter::Client_OnDied_Implementation()
+{
+	// clear the ammo counter
+	OnBulletCountUpdated.Broadcast(0, 0);
 }
 
 void AShooterCharacter::Auth_OnRespawn()
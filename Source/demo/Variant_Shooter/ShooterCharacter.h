@@ -5,12 +5,19 @@
 #include "CoreMinimal.h"
 #include "demoCharacter.h"
 #include "ShooterWeaponHolder.h"
+#include "GenericTeamAgentInterface.h"
+#include "ShooterCombatNetState.h"
+#include "ShooterInputState.h"
+#include "ShooterDeathInfo.h"
 #include "ShooterCharacter.generated.h"
 
 class AShooterWeapon;
 class UInputAction;
 class UInputComponent;
 class UPawnNoiseEmitterComponent;
+class UShooterNetRateComponent;
+class USkeletalMeshComponent;
+class UAnimInstance;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FBulletCountUpdatedDelegate, int32, MagazineSize, int32, Bullets);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FDamagedDelegate, float, LifePercent);
@@ -23,7 +30,7 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE(FDamageEffectDelegate);
  *  Manages health and death
  */
 UCLASS(abstract)
-class DEMO_API AShooterCharacter : public AdemoCharacter, public IShooterWeaponHolder
+class DEMO_API AShooterCharacter : public AdemoCharacter, public IShooterWeaponHolder, public IGenericTeamAgentInterface
 {
 	GENERATED_BODY()
 	
@@ -31,6 +38,10 @@ class DEMO_API AShooterCharacter : public AdemoCharacter, public IShooterWeaponH
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
 	UPawnNoiseEmitterComponent* PawnNoiseEmitter;
 
+	/** Adapts the net update frequency to combat activity */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
+	UShooterNetRateComponent* NetRate;
+
 protected:
 
 	/** Fire weapon input action */
@@ -57,10 +68,17 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Health")
 	float MaxHP = 500.0f;
 
-	/** Current HP remaining to this character */
-	UPROPERTY(ReplicatedUsing="OnRep_CurrentHP")
+	/** Current HP remaining to this character. Clients derive it from the combat state */
 	float CurrentHP = 0.0f;
 
+	/** Packed health, ammo and flags replicated to clients */
+	UPROPERTY(ReplicatedUsing="OnRep_CombatState")
+	FCombatNetState CombatState;
+
+	/** Time and killer of this character's death */
+	UPROPERTY(ReplicatedUsing="OnRep_DeathInfo")
+	FShooterDeathInfo DeathInfo;
+
 	/** Team ID for this character*/
 	UPROPERTY(EditAnywhere, Category="Team")
 	uint8 TeamByte = 0;
@@ -73,11 +91,62 @@ protected:
 	UPROPERTY(ReplicatedUsing = OnRep_CurrentWeapon)
 	TObjectPtr<AShooterWeapon> CurrentWeapon;
 
+	/** Weapon shown on this machine. Runs ahead of CurrentWeapon on the owning client while a switch is predicted */
+	UPROPERTY(Transient)
+	TObjectPtr<AShooterWeapon> EquippedWeapon;
+
+	/** Switch count of the last input update applied by the server. Used by the owning client as the prediction key for weapon switches */
+	UPROPERTY(ReplicatedUsing = OnRep_ConfirmedSwitchCount)
+	uint8 ConfirmedSwitchCount = 0;
+
+	/** Sequence number of the last input update applied by the server. Lets the owning client know when to stop resending it */
+	UPROPERTY(Replicated)
+	uint8 ConfirmedInputSequence = 0;
+
 	UPROPERTY(EditAnywhere, Category ="Destruction", meta = (ClampMin = 0, ClampMax = 10, Units = "s"))
 	float RespawnTime = 5.0f;
 
 	FTimerHandle RespawnTimer;
 
+	/** Max weapon input updates per second a client may send. Extra updates are dropped by the server */
+	UPROPERTY(EditAnywhere, Category="Input|Network", meta = (ClampMin = 1, ClampMax = 120))
+	float MaxInputUpdatesPerSecond = 30.0f;
+
+	/** Number of times an input update is repeated after a change, since it's sent unreliably */
+	UPROPERTY(EditAnywhere, Category="Input|Network", meta = (ClampMin = 0, ClampMax = 10))
+	int32 InputRedundancy = 2;
+
+	/** Time to wait for the server to confirm an input update before sending it again */
+	UPROPERTY(EditAnywhere, Category="Input|Network", meta = (ClampMin = 0.05, ClampMax = 2, Units = "s"))
+	float UnconfirmedInputResendInterval = 0.15f;
+
+	/** Weapon inputs gathered on the owning client */
+	FShooterInputState LocalInput;
+
+	/** If true, the local input changed since the last update was sent */
+	bool bLocalInputDirty = false;
+
+	/** Repeats of the current input update left to send */
+	int32 InputResendsLeft = 0;
+
+	/** Time the last input update was sent */
+	double LastInputSendTime = 0.0;
+
+	/** Last input update received by the server, waiting to be applied on tick */
+	FShooterInputState PendingInput;
+
+	/** Last input update applied by the server */
+	FShooterInputState AppliedInput;
+
+	/** If true, the server has an input update waiting to be applied */
+	bool bHasPendingInput = false;
+
+	/** Input updates the client may still send before being rate limited */
+	float InputRateTokens = 0.0f;
+
+	/** Time the input rate tokens were last refilled */
+	double InputRateRefillTime = 0.0;
+
 public:
 
 	/** Bullet count updated delegate */
@@ -97,27 +166,50 @@ public:
 protected:
 
 	UFUNCTION()
-	void OnRep_CurrentWeapon(AShooterWeapon* OldWeapon);
+	void OnRep_CurrentWeapon();
+
+	UFUNCTION()
+	void OnRep_ConfirmedSwitchCount();
 	
 	UFUNCTION()
-	void OnRep_CurrentHP();
+	void OnRep_CombatState(const FCombatNetState& OldState);
 	virtual void GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const override;
 
-	UFUNCTION(Server, Reliable)
-	void Server_StartFiring();
-	UFUNCTION(Server, Reliable)
-	void Server_StopFiring();
-	UFUNCTION(Server, Reliable)
-	void Server_SwitchWeapon();
+	/** Sends the owning client's weapon inputs. Coalesced to at most one update per tick */
+	UFUNCTION(Server, Unreliable)
+	void Server_UpdateInput(FShooterInputState InputState);
+
+	/** Applies a received input update. Only the net change since the last applied update is acted on */
+	void Auth_ApplyInput(const FShooterInputState& InputState);
+
+	/** Sends the local input update if it changed or needs repeating */
+	void Local_FlushInput();
+
 	void Auth_StopFiring();
 	void Auth_StartFiring();
-	void Auth_SwitchWeapon();
+	void Auth_SwitchWeapon(int32 Steps = 1);
+
+	/** Switches to the next weapon on the owning client without waiting for the server */
+	void Local_PredictSwitchWeapon();
+
+	/** Shows the authoritative weapon once the server has caught up with every predicted switch */
+	void Local_ReconcileWeapon();
+
+	/** Hides the shown weapon and shows the passed one on this machine only */
+	void Local_EquipWeapon(AShooterWeapon* Weapon);
+
+	/** Links the weapon's anim layers on a mesh, or swaps its AnimInstance class if the weapon has no layers */
+	void ApplyWeaponAnimation(USkeletalMeshComponent* Mesh, const TSubclassOf<UAnimInstance>& LayerClass, const TSubclassOf<UAnimInstance>& InstanceClass);
+
 	/** Gameplay initialization */
 	virtual void BeginPlay() override;
 
 	/** Gameplay cleanup */
 	virtual void EndPlay(EEndPlayReason::Type EndPlayReason) override;
 
+	/** Sends and applies coalesced weapon inputs */
+	virtual void Tick(float DeltaSeconds) override;
+
 	/** Set up input action bindings */
 	virtual void SetupPlayerInputComponent(UInputComponent* InputComponent) override;
 
@@ -143,6 +235,20 @@ public:
 
 public:
 	float GetHealthPercent() const { return CurrentHP / MaxHP; }
+
+	/** Returns the team byte for this character */
+	uint8 GetTeamByte() const { return TeamByte; }
+
+	//~Begin IGenericTeamAgentInterface interface
+
+	/** Returns the team ID built from the team byte */
+	virtual FGenericTeamId GetGenericTeamId() const override { return FGenericTeamId(TeamByte); }
+
+	//~End IGenericTeamAgentInterface interface
+
+	/** Culls this character for enemy connections that can't see it */
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
 	//~Begin IShooterWeaponHolder interface
 
 	/** Attaches a weapon's meshes to the owner */
@@ -181,8 +287,14 @@ protected:
 
 	/** Called when this character's HP is depleted */
 	void Auth_Die(AController* KillerController);
-	UFUNCTION(NetMulticast,Reliable)
-	void MC_Die();
+
+	/** Stops the character on every machine once it's dead */
+	UFUNCTION()
+	void OnRep_DeathInfo();
+
+	/** Resets the owning player's HUD on death */
+	UFUNCTION(Client, Reliable)
+	void Client_OnDied();
 
 	/** Called to allow Blueprint code to react to this character's death */
 	UFUNCTION(BlueprintImplementableEvent, Category="Shooter", meta = (DisplayName = "On Death"))
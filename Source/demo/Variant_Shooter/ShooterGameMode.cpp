@@ -7,6 +7,7 @@
 #include "ShooterUI.h"
 #include "Kismet/GameplayStatics.h"
 #include "Engine/World.h"
+#include "ShooterJoinReplicationSubsystem.h"
 
 void AShooterGameMode::BeginPlay()
 {
@@ -14,3 +15,16 @@ void AShooterGameMode::BeginPlay()
 	
 }
 
+void AShooterGameMode::PostLogin(APlayerController* NewPlayer)
+{
+	Super::PostLogin(NewPlayer);
+
+	// players that are there from the start get the normal initial replication
+	if (IsMatchInProgress())
+	{
+		if (UShooterJoinReplicationSubsystem* JoinReplication = GetWorld()->GetSubsystem<UShooterJoinReplicationSubsystem>())
+		{
+			JoinReplication->Auth_RegisterJoiningPlayer(NewPlayer);
+		}
+	}
+}
@@ -26,6 +26,9 @@ protected:
 	/** Gameplay initialization */
 	virtual void BeginPlay() override;
 
+	/** Staggers the initial replication for players joining a match in progress */
+	virtual void PostLogin(APlayerController* NewPlayer) override;
+
 public:
 
 };
@@ -7,14 +7,20 @@
 #include "Components/StaticMeshComponent.h"
 #include "ShooterWeaponHolder.h"
 #include "ShooterWeapon.h"
+#include "ShooterJoinReplicationSubsystem.h"
+#include "GameFramework/GameStateBase.h"
 #include "Engine/World.h"
 #include "TimerManager.h"
+#include "Net/UnrealNetwork.h"
 
 AShooterPickup::AShooterPickup()
 {
  	PrimaryActorTick.bCanEverTick = true;
 
 	bReplicates = true;
+
+	// pickups only replicate when they're picked up
+	NetDormancy = DORM_DormantAll;
 	
 	// create the root
 	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
@@ -42,11 +48,33 @@ AShooterPickup::AShooterPickup()
 	
 }
  
-void AShooterPickup::MC_OnPickedUp_Implementation()
+void AShooterPickup::OnRep_AvailableAtServerTime()
 {
-	SetActorHiddenInGame(true);
-	SetActorEnableCollision(false);
-	SetActorTickEnabled(false);
+	const float TimeUntilAvailable = AvailableAtServerTime - GetServerTime();
+
+	// already available, e.g. for late joiners receiving an old pickup time
+	if (TimeUntilAvailable <= 0.0f)
+	{
+		GetWorld()->GetTimerManager().ClearTimer(RespawnTimer);
+
+		if (!bIsAvailable)
+		{
+			RespawnPickup();
+		}
+
+		return;
+	}
+
+	HidePickup();
+
+	// respawn locally when the time comes, no further replication needed
+	GetWorld()->GetTimerManager().SetTimer(RespawnTimer, this, &AShooterPickup::RespawnPickup, TimeUntilAvailable, false);
+}
+
+void AShooterPickup::GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+	DOREPLIFETIME(AShooterPickup, AvailableAtServerTime);
 }
 
 void AShooterPickup::OnConstruction(const FTransform& Transform)
@@ -80,25 +108,45 @@ void AShooterPickup::EndPlay(const EEndPlayReason::Type EndPlayReason)
 	GetWorld()->GetTimerManager().ClearTimer(RespawnTimer);
 }
 
+bool AShooterPickup::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	if (!Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation))
+	{
+		return false;
+	}
+
+	// late joiners get nearby pickups with the world, and distant ones last
+	if (UShooterJoinReplicationSubsystem* JoinReplication = GetWorld()->GetSubsystem<UShooterJoinReplicationSubsystem>())
+	{
+		return JoinReplication->IsUnlockedFor(RealViewer, JoinReplication->GetPriorityByDistance(this, SrcLocation, EShooterJoinPriority::World, EShooterJoinPriority::Deferred));
+	}
+
+	return true;
+}
+
 void AShooterPickup::OnOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
-	if (!HasAuthority())
+	if (!HasAuthority() || !bIsAvailable)
 		return;
 
 	// have we collided against a weapon holder?
 	if (IShooterWeaponHolder* WeaponHolder = Cast<IShooterWeaponHolder>(OtherActor))
 	{
 		WeaponHolder->AddWeaponClass(WeaponClass);
-		
-		MC_OnPickedUp();
 
-		// schedule the respawn
-		GetWorld()->GetTimerManager().SetTimer(RespawnTimer, this, &AShooterPickup::RespawnPickup, RespawnTime, false);
+		// wake the pickup up just long enough to send the new availability time
+		FlushNetDormancy();
+		AvailableAtServerTime = GetServerTime() + RespawnTime;
+
+		// the server runs the same respawn logic, so call the notify even on dedicated servers
+		OnRep_AvailableAtServerTime();
 	}
 }
 
 void AShooterPickup::RespawnPickup()
 {
+	bIsAvailable = true;
+
 	// unhide this pickup
 	SetActorHiddenInGame(false);
 
@@ -114,3 +162,23 @@ void AShooterPickup::FinishRespawn()
 	// enable tick
 	SetActorTickEnabled(true);
 }
+
+void AShooterPickup::HidePickup()
+{
+	bIsAvailable = false;
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+	SetActorTickEnabled(false);
+}
+
+double AShooterPickup::GetServerTime() const
+{
+	// the game state keeps clients roughly in sync with the server clock
+	if (const AGameStateBase* GameState = GetWorld()->GetGameState())
+	{
+		return GameState->GetServerWorldTimeSeconds();
+	}
+
+	return GetWorld()->GetTimeSeconds();
+}
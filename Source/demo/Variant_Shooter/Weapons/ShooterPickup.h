@@ -58,6 +58,13 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Pickup", meta = (ClampMin = 0, ClampMax = 120, Units = "s"))
 	float RespawnTime = 4.0f;
 
+	/** Server world time at which this pickup can be picked up again. Each machine derives visibility and respawn timing from it */
+	UPROPERTY(ReplicatedUsing=OnRep_AvailableAtServerTime)
+	float AvailableAtServerTime = 0.0f;
+
+	/** If true, the pickup is currently shown and can be picked up on this machine */
+	bool bIsAvailable = true;
+
 	/** Timer to respawn the pickup */
 	FTimerHandle RespawnTimer;
 
@@ -69,8 +76,11 @@ public:
 	
 protected:
 
-	UFUNCTION(NetMulticast, Reliable)
-	void MC_OnPickedUp();
+	/** Updates the local pickup state from the replicated availability time */
+	UFUNCTION()
+	void OnRep_AvailableAtServerTime();
+
+	virtual void GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const override;
 	
 	/** Native construction script */
 	virtual void OnConstruction(const FTransform& Transform) override;
@@ -81,6 +91,9 @@ protected:
 	/** Gameplay cleanup */
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
+	/** Defers distant pickups for players joining a match in progress */
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
 	/** Handles collision overlap */
 	UFUNCTION()
 	virtual void OnOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
@@ -90,6 +103,12 @@ protected:
 	/** Called when it's time to respawn this pickup */
 	void RespawnPickup();
 
+	/** Hides and disables this pickup on this machine */
+	void HidePickup();
+
+	/** Returns the server world time as known by this machine */
+	double GetServerTime() const;
+
 	/** Passes control to Blueprint to animate the pickup respawn. Should end by calling FinishRespawn */
 	UFUNCTION(BlueprintImplementableEvent, Category="Pickup", meta = (DisplayName = "OnRespawn"))
 	void BP_OnRespawn();
@@ -12,6 +12,9 @@
 #include "Engine/OverlapResult.h"
 #include "Engine/World.h"
 #include "TimerManager.h"
+#include "ShooterJoinReplicationSubsystem.h"
+#include "ShooterNoiseSubsystem.h"
+#include "ShooterInfluenceMapSubsystem.h"
 
 AShooterProjectile::AShooterProjectile()
 {
@@ -53,6 +56,22 @@ void AShooterProjectile::EndPlay(EEndPlayReason::Type EndPlayReason)
 	GetWorld()->GetTimerManager().ClearTimer(DestructionTimer);
 }
 
+bool AShooterProjectile::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	if (!Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation))
+	{
+		return false;
+	}
+
+	// projectiles are short lived and cosmetic to a late joiner, so they go last
+	if (UShooterJoinReplicationSubsystem* JoinReplication = GetWorld()->GetSubsystem<UShooterJoinReplicationSubsystem>())
+	{
+		return JoinReplication->IsUnlockedFor(RealViewer, EShooterJoinPriority::Deferred);
+	}
+
+	return true;
+}
+
 void AShooterProjectile::NotifyHit(class UPrimitiveComponent* MyComp, AActor* Other, class UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit)
 {
 	// ignore if we've already hit something else
@@ -66,8 +85,14 @@ void AShooterProjectile::NotifyHit(class UPrimitiveComponent* MyComp, AActor* Ot
 	// disable collision on the projectile
 	CollisionComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 
-	// make AI perception noise
-	MakeNoise(NoiseLoudness, GetInstigator(), GetActorLocation(), NoiseRange, NoiseTag);
+	// make AI perception noise. Impacts close together are merged into a single event
+	UShooterNoiseSubsystem::Auth_ReportNoise(this, GetActorLocation(), NoiseLoudness, GetInstigator(), NoiseRange, NoiseTag);
+
+	// and mark it on the tactical map
+	if (UShooterInfluenceMapSubsystem* InfluenceMap = GetWorld()->GetSubsystem<UShooterInfluenceMapSubsystem>())
+	{
+		InfluenceMap->Auth_ReportNoise(GetActorLocation(), NoiseLoudness);
+	}
 
 	if (bExplodeOnHit)
 	{
@@ -8,6 +8,9 @@
 #include "Engine/World.h"
 #include "ShooterProjectile.h"
 #include "ShooterWeaponHolder.h"
+#include "ShooterNetRateComponent.h"
+#include "ShooterNoiseSubsystem.h"
+#include "ShooterInfluenceMapSubsystem.h"
 #include "Components/SceneComponent.h"
 #include "TimerManager.h"
 #include "Animation/AnimInstance.h"
@@ -18,7 +21,7 @@
 void AShooterWeapon::GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
-    DOREPLIFETIME(AShooterWeapon, CurrentBullets);
+	DOREPLIFETIME(AShooterWeapon, PawnOwner);
 }
 
 AShooterWeapon::AShooterWeapon()
@@ -44,7 +47,13 @@ AShooterWeapon::AShooterWeapon()
 	ThirdPersonMesh->SetFirstPersonPrimitiveType(EFirstPersonPrimitiveType::WorldSpaceRepresentation);
 	ThirdPersonMesh->bOwnerNoSee = true;
 
+	// create the net rate component
+	NetRate = CreateDefaultSubobject<UShooterNetRateComponent>(TEXT("Net Rate"));
+
 	bReplicates = true;
+
+	// weapons are held, so they're culled together with their owner
+	bNetUseOwnerRelevancy = true;
 }
 
 void AShooterWeapon::BeginPlay()
@@ -99,12 +108,6 @@ void AShooterWeapon::OnOwnerDestroyed(AActor* DestroyedActor)
 	Destroy();
 }
 
-void AShooterWeapon::OnRep_CurrentBullets()
-{
-	if (WeaponOwner)
-		WeaponOwner->UpdateWeaponHUD(CurrentBullets,MagazineSize);
-}
-
 void AShooterWeapon::ActivateWeapon()
 {
 	// unhide this weapon+
@@ -159,6 +162,14 @@ void AShooterWeapon::Auth_StopFiring()
 	GetWorld()->GetTimerManager().ClearTimer(RefireTimer);
 }
 
+void AShooterWeapon::Auth_ResetForReuse()
+{
+	Auth_StopFiring();
+
+	// come back with a full magazine
+	CurrentBullets = MagazineSize;
+}
+
 void AShooterWeapon::Auth_DoFire()
 {
 	// ensure the player still wants to fire. They may have let go of the trigger
@@ -176,8 +187,18 @@ void AShooterWeapon::Auth_DoFire()
 	// update the time of our last shot
 	TimeOfLastShot = GetWorld()->GetTimeSeconds();
 
-	// make noise so the AI perception system can hear us
-	MakeNoise(ShotLoudness, PawnOwner, PawnOwner->GetActorLocation(), ShotNoiseRange, ShotNoiseTag);
+	// make noise so the AI perception system can hear us. Full auto bursts are merged into a single event
+	UShooterNoiseSubsystem::Auth_ReportNoise(this, PawnOwner->GetActorLocation(), ShotLoudness, PawnOwner, ShotNoiseRange, ShotNoiseTag);
+
+	// mark the shooter's position on the tactical map
+	if (UShooterInfluenceMapSubsystem* InfluenceMap = GetWorld()->GetSubsystem<UShooterInfluenceMapSubsystem>())
+	{
+		InfluenceMap->Auth_ReportShot(PawnOwner, PawnOwner->GetActorLocation(), ShotLoudness);
+	}
+
+	// firing is combat, so both the weapon and its owner replicate at the active rate
+	NetRate->Auth_NotifyActivity();
+	UShooterNetRateComponent::Auth_NotifyActivity(PawnOwner);
 
 	// are we full auto?
 	if (bFullAuto)
@@ -219,7 +240,8 @@ void AShooterWeapon::Auth_FireProjectile(const FVector& TargetLocation)
 		CurrentBullets = MagazineSize;
 	}
 
-	SV_REPCALL(CurrentBullets);
+	// push the new ammo count to the owner's combat state
+	WeaponOwner->UpdateWeaponHUD(CurrentBullets, MagazineSize);
 }
 
 void AShooterWeapon::MC_Fire_Implementation()
@@ -13,6 +13,7 @@ class AShooterProjectile;
 class USkeletalMeshComponent;
 class UAnimMontage;
 class UAnimInstance;
+class UShooterNetRateComponent;
 
 /**
  *  Base class for a simple first person shooter weapon
@@ -33,6 +34,10 @@ class DEMO_API AShooterWeapon : public AActor
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
 	USkeletalMeshComponent* ThirdPersonMesh;
 
+	/** Adapts the net update frequency to firing activity */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
+	UShooterNetRateComponent* NetRate;
+
 protected:
 
 	/** Cast pointer to the weapon owner */
@@ -46,8 +51,7 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Ammo", meta = (ClampMin = 0, ClampMax = 100))
 	int32 MagazineSize = 10;
 
-	/** Number of bullets in the current magazine */
-	UPROPERTY(ReplicatedUsing="OnRep_CurrentBullets")
+	/** Number of bullets in the current magazine. Reaches clients through the owner's combat state */
 	int32 CurrentBullets = 0;
 	
 	/** Animation montage to play when firing this weapon */
@@ -62,6 +66,14 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Animation")
 	TSubclassOf<UAnimInstance> ThirdPersonAnimInstanceClass;
 
+	/** Anim layers to link on the first person character mesh when this weapon is active. If unset, the AnimInstance class is swapped instead */
+	UPROPERTY(EditAnywhere, Category="Animation")
+	TSubclassOf<UAnimInstance> FirstPersonAnimLayerClass;
+
+	/** Anim layers to link on the third person character mesh when this weapon is active. If unset, the AnimInstance class is swapped instead */
+	UPROPERTY(EditAnywhere, Category="Animation")
+	TSubclassOf<UAnimInstance> ThirdPersonAnimLayerClass;
+
 	/** Cone half-angle for variance while aiming */
 	UPROPERTY(EditAnywhere, Category="Aim", meta = (ClampMin = 0, ClampMax = 90, Units = "Degrees"))
 	float AimVariance = 0.0f;
@@ -134,8 +146,6 @@ protected:
 	UFUNCTION()
 	void OnOwnerDestroyed(AActor* DestroyedActor);
 
-	UFUNCTION()
-	void OnRep_CurrentBullets();
 public:
 
 	
@@ -151,6 +161,9 @@ public:
 	/** Stop firing this weapon */
 	void Auth_StopFiring();
 
+	/** Stops firing and refills the magazine, for owners coming back from the NPC pool */
+	void Auth_ResetForReuse();
+
 protected:
 
 	/** Fire the weapon */
@@ -187,6 +200,12 @@ public:
 	/** Returns the third person anim instance class */
 	const TSubclassOf<UAnimInstance>& GetThirdPersonAnimInstanceClass() const;
 
+	/** Returns the first person anim layer class */
+	const TSubclassOf<UAnimInstance>& GetFirstPersonAnimLayerClass() const { return FirstPersonAnimLayerClass; };
+
+	/** Returns the third person anim layer class */
+	const TSubclassOf<UAnimInstance>& GetThirdPersonAnimLayerClass() const { return ThirdPersonAnimLayerClass; };
+
 	/** Returns the magazine size */
 	int32 GetMagazineSize() const { return MagazineSize; };
 
@@ -15,8 +15,12 @@ public class demo : ModuleRules
 			"InputCore",
 			"EnhancedInput",
 			"AIModule",
+			"NavigationSystem",
 			"StateTreeModule",
 			"GameplayStateTreeModule",
+			"MassEntity",
+			"MassCommon",
+			"DeveloperSettings",
 			"UMG",
 			"Slate"
 		});
@@ -29,6 +33,8 @@ public class demo : ModuleRules
 			"demo/Variant_Horror/UI",
 			"demo/Variant_Shooter",
 			"demo/Variant_Shooter/AI",
+			"demo/Variant_Shooter/Mass",
+			"demo/Variant_Shooter/Net",
 			"demo/Variant_Shooter/UI",
 			"demo/Variant_Shooter/Weapons"
 		});
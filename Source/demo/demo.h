@@ -9,8 +9,10 @@ DECLARE_LOG_CATEGORY_EXTERN(Logdemo, Log, All);
 
 #if UE_SERVER
 #define SV_REPCALL(Var)
+#define SV_REPCALL_PREV(Var, OldVar)
 #else
 #define SV_REPCALL(Var) OnRep_##Var()
+#define SV_REPCALL_PREV(Var, OldVar) OnRep_##Var(OldVar)
 #endif
 
 #define ENSURE_AUTH() ensure(HasAuthority())
\ No newline at end of file